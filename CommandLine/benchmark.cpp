@@ -0,0 +1,482 @@
+#include <planedetector.h>
+#include <planarpatch.h>
+#include <normalestimator.h>
+#include <nearestneighborcalculator.h>
+#include <boundaryvolumehierarchy.h>
+#include <connectivitygraph.h>
+#include <statisticsutils.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <functional>
+#include <map>
+
+// Micro and macro benchmarks of the hot paths of CoreLib and DetectionLib on synthetic scenes.
+// Every scene and input is generated from a fixed seed, so two runs on the same machine measure the same work.
+
+struct Options
+{
+    std::vector<size_t> sizes;
+    std::vector<size_t> threads;
+    size_t repeats;
+    size_t warmup;
+    unsigned int seed;
+    size_t numNormalPoints;
+    std::string filter;
+    std::string csvFileName;
+    std::string jsonFileName;
+    std::string baselineFileName;
+    float threshold;
+};
+
+struct Result
+{
+    std::string name;
+    size_t size;
+    size_t threads;
+    std::vector<double> times;
+    size_t items;
+
+    double min() const
+    {
+        return *std::min_element(times.begin(), times.end());
+    }
+
+    double median() const
+    {
+        std::vector<double> sorted(times);
+        std::sort(sorted.begin(), sorted.end());
+        return sorted[sorted.size() / 2];
+    }
+
+    double mean() const
+    {
+        double sum = 0;
+        for (const double &time : times) sum += time;
+        return sum / times.size();
+    }
+
+    double max() const
+    {
+        return *std::max_element(times.begin(), times.end());
+    }
+
+    std::string key() const
+    {
+        return name + "/" + std::to_string(size) + "/" + std::to_string(threads);
+    }
+};
+
+std::vector<size_t> parseList(const std::string &list)
+{
+    std::vector<size_t> values;
+    std::istringstream stream(list);
+    std::string value;
+    while (std::getline(stream, value, ','))
+    {
+        values.push_back(std::stoul(value));
+    }
+    if (values.empty()) throw "Empty list: " + list;
+    return values;
+}
+
+// a closed room with two walls inside it, sampled uniformly with a little noise
+PointCloud3d* generateScene(size_t numPoints, unsigned int seed)
+{
+    struct Face { Eigen::Vector3f origin, u, v; };
+    const Face faces[] = {
+        { Eigen::Vector3f(0, 0, 0), Eigen::Vector3f(20, 0, 0), Eigen::Vector3f(0, 20, 0) },
+        { Eigen::Vector3f(0, 0, 4), Eigen::Vector3f(20, 0, 0), Eigen::Vector3f(0, 20, 0) },
+        { Eigen::Vector3f(0, 0, 0), Eigen::Vector3f(20, 0, 0), Eigen::Vector3f(0, 0, 4) },
+        { Eigen::Vector3f(0, 20, 0), Eigen::Vector3f(20, 0, 0), Eigen::Vector3f(0, 0, 4) },
+        { Eigen::Vector3f(0, 0, 0), Eigen::Vector3f(0, 20, 0), Eigen::Vector3f(0, 0, 4) },
+        { Eigen::Vector3f(20, 0, 0), Eigen::Vector3f(0, 20, 0), Eigen::Vector3f(0, 0, 4) },
+        { Eigen::Vector3f(8, 2, 0), Eigen::Vector3f(0, 10, 0), Eigen::Vector3f(0, 0, 4) },
+        { Eigen::Vector3f(10, 14, 0), Eigen::Vector3f(8, 0, 0), Eigen::Vector3f(0, 0, 4) }
+    };
+    const size_t numFaces = sizeof(faces) / sizeof(Face);
+    float totalArea = 0;
+    for (size_t i = 0; i < numFaces; i++) totalArea += faces[i].u.cross(faces[i].v).norm();
+
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<float> uniform(0, 1);
+    std::normal_distribution<float> noise(0, 0.005f);
+    std::vector<Point3d> points;
+    points.reserve(numPoints);
+    for (size_t i = 0; i < numFaces; i++)
+    {
+        const Face &face = faces[i];
+        size_t numFacePoints = i + 1 < numFaces ? size_t(numPoints * face.u.cross(face.v).norm() / totalArea) : numPoints - points.size();
+        Eigen::Vector3f normal = face.u.cross(face.v).normalized();
+        for (size_t j = 0; j < numFacePoints; j++)
+        {
+            Eigen::Vector3f position = face.origin + face.u * uniform(generator) + face.v * uniform(generator) + normal * noise(generator);
+            points.push_back(Point3d(position));
+        }
+    }
+    return new PointCloud3d(points);
+}
+
+// the normals and connectivity the detector needs, estimated the same way as command_line does
+void prepareScene(PointCloud3d *pointCloud)
+{
+    Octree octree(pointCloud);
+    octree.partition(10, 30);
+    ConnectivityGraph *connectivity = new ConnectivityGraph(pointCloud->size());
+    pointCloud->connectivity(connectivity);
+    NormalEstimator3d estimator(&octree, 30, NormalEstimator3d::QUICK);
+    for (size_t i = 0; i < pointCloud->size(); i++)
+    {
+        NormalEstimator3d::Normal normal = estimator.estimate(i);
+        connectivity->addNode(i, normal.neighbors);
+        (*pointCloud)[i].normal(normal.normal);
+        (*pointCloud)[i].normalConfidence(normal.confidence);
+        (*pointCloud)[i].curvature(normal.curvature);
+    }
+}
+
+// runs job(begin, end) over [0, numItems) split in contiguous ranges, one per thread
+void parallelFor(size_t numItems, size_t numThreads, const std::function<void(size_t, size_t)> &job)
+{
+    if (numThreads <= 1)
+    {
+        job(0, numItems);
+        return;
+    }
+    std::vector<std::thread> workers;
+    size_t chunkSize = (numItems + numThreads - 1) / numThreads;
+    for (size_t begin = 0; begin < numItems; begin += chunkSize)
+    {
+        workers.push_back(std::thread(job, begin, std::min(numItems, begin + chunkSize)));
+    }
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+class Benchmark
+{
+public:
+    Benchmark(const Options &options)
+        : mOptions(options)
+    {
+
+    }
+
+    bool enabled(const std::string &name) const
+    {
+        return mOptions.filter.empty() || name.find(mOptions.filter) != std::string::npos;
+    }
+
+    // warm-up runs are discarded, every run calls setup first (untimed) and then the timed body
+    void run(const std::string &name, size_t size, size_t threads, size_t items,
+             const std::function<void()> &setup, const std::function<void()> &body)
+    {
+        if (!enabled(name)) return;
+        Result result;
+        result.name = name;
+        result.size = size;
+        result.threads = threads;
+        result.items = items;
+        for (size_t i = 0; i < mOptions.warmup + mOptions.repeats; i++)
+        {
+            setup();
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            body();
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            if (i >= mOptions.warmup) result.times.push_back(elapsed.count());
+        }
+        report(result);
+    }
+
+    // several results measured by one run (e.g. the phases of a detection)
+    void runPhases(const std::vector<std::string> &names, size_t size, size_t items,
+                   const std::function<void(std::vector<double>&)> &body)
+    {
+        bool any = false;
+        for (const std::string &name : names) any = any || enabled(name);
+        if (!any) return;
+        std::vector<Result> results(names.size());
+        for (size_t i = 0; i < mOptions.warmup + mOptions.repeats; i++)
+        {
+            std::vector<double> times(names.size(), 0);
+            body(times);
+            if (i < mOptions.warmup) continue;
+            for (size_t j = 0; j < names.size(); j++)
+            {
+                results[j].times.push_back(times[j]);
+            }
+        }
+        for (size_t j = 0; j < names.size(); j++)
+        {
+            if (!enabled(names[j])) continue;
+            results[j].name = names[j];
+            results[j].size = size;
+            results[j].threads = 1;
+            results[j].items = items;
+            report(results[j]);
+        }
+    }
+
+    const std::vector<Result>& results() const
+    {
+        return mResults;
+    }
+
+private:
+    const Options &mOptions;
+    std::vector<Result> mResults;
+
+    void report(const Result &result)
+    {
+        std::cout << result.name << " (" << result.size << " points, " << result.threads << " threads): median " << result.median()
+                  << "s, min " << result.min() << "s, max " << result.max() << "s, " << result.items / result.median() << " items/s" << std::endl;
+        mResults.push_back(result);
+    }
+
+};
+
+void runBenchmarks(const Options &options, Benchmark &benchmark)
+{
+    for (const size_t &size : options.sizes)
+    {
+        std::cout << "Generating a scene of " << size << " points..." << std::endl;
+        PointCloud3d *pointCloud = generateScene(size, options.seed);
+
+        benchmark.run("octree_build", size, 1, size, [] {}, [pointCloud] {
+            Octree octree(pointCloud);
+            octree.partition(10, 30);
+        });
+
+        Octree octree(pointCloud);
+        octree.partition(10, 30);
+        // normal estimation is slow, so it runs on an evenly spaced subset of the points
+        size_t numQueries = std::min(size, options.numNormalPoints);
+        std::vector<size_t> queries(numQueries);
+        for (size_t i = 0; i < numQueries; i++) queries[i] = i * size / numQueries;
+
+        for (const size_t &threads : options.threads)
+        {
+            benchmark.run("knn", size, threads, numQueries, [] {}, [&octree, &queries, threads] {
+                parallelFor(queries.size(), threads, [&octree, &queries](size_t begin, size_t end) {
+                    for (size_t i = begin; i < end; i++) NearestNeighborCalculator3d::kNN(&octree, queries[i], 30);
+                });
+            });
+            const NormalEstimator3d::Speed speeds[] = { NormalEstimator3d::QUICK, NormalEstimator3d::SLOW };
+            const char *names[] = { "normals_quick", "normals_slow" };
+            for (size_t s = 0; s < 2; s++)
+            {
+                NormalEstimator3d::Speed speed = speeds[s];
+                // the SLOW estimation draws random subsets, the seed keeps them the same between runs
+                benchmark.run(names[s], size, threads, numQueries, [&options] { std::srand(options.seed); }, [&octree, &queries, threads, speed] {
+                    parallelFor(queries.size(), threads, [&octree, &queries, speed](size_t begin, size_t end) {
+                        NormalEstimator3d estimator(&octree, 30, speed);
+                        for (size_t i = begin; i < end; i++) estimator.estimate(queries[i]);
+                    });
+                });
+            }
+        }
+
+        // the estimation uses the connectivity instead of kNN once it exists, so it is only built now
+        prepareScene(pointCloud);
+
+        StatisticsUtils statistics(size);
+        benchmark.run("median_mad", size, 1, size, [&statistics, &options, size] {
+            std::mt19937 generator(options.seed);
+            std::normal_distribution<float> distribution(0, 1);
+            statistics.size(size);
+            for (size_t i = 0; i < size; i++) statistics.dataBuffer()[i] = distribution(generator);
+        }, [&statistics] {
+            float median = statistics.getMedian();
+            statistics.getMAD(median);
+        });
+
+        // the candidate regions of the patch detection: octree cells below the third level
+        size_t minNumPoints = std::max(size_t(10), size_t(size * 0.001f));
+        Octree cells(pointCloud);
+        cells.partition(10, minNumPoints);
+        std::vector<std::vector<size_t> > regions;
+        std::vector<const Partitioner3d*> stack(1, &cells);
+        while (!stack.empty())
+        {
+            const Partitioner3d *node = stack.back();
+            stack.pop_back();
+            if (node->numPoints() < minNumPoints) continue;
+            if (static_cast<const Octree*>(node)->octreeLevel() > 2) regions.push_back(node->points());
+            for (const Partitioner3d *child : node->children()) stack.push_back(child);
+        }
+        size_t numRegionPoints = 0;
+        for (const std::vector<size_t> &region : regions) numRegionPoints += region.size();
+        benchmark.run("is_planar", size, 1, numRegionPoints, [] {}, [pointCloud, &regions, &statistics] {
+            for (const std::vector<size_t> &region : regions)
+            {
+                PlanarPatch patch(pointCloud, &statistics, region, 0.5f, 0.258819f, 0.75f);
+                patch.isPlanar();
+            }
+        });
+
+        const std::vector<std::string> phases = { "detect", "detect_patches", "grow", "merge", "delimit" };
+        benchmark.runPhases(phases, size, size, [pointCloud](std::vector<double> &times) {
+            PlaneDetector detector(pointCloud);
+            detector.minNormalDiff(0.5f);
+            detector.maxDist(0.258819f);
+            detector.outlierRatio(0.75f);
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            std::set<Plane*> planes = detector.detect();
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            times[0] = elapsed.count();
+            times[1] = detector.metrics().time(PlaneDetectorMetrics::DETECT_PATCHES);
+            times[2] = detector.metrics().time(PlaneDetectorMetrics::GROW) + detector.metrics().time(PlaneDetectorMetrics::RELAXED_GROW);
+            times[3] = detector.metrics().time(PlaneDetectorMetrics::MERGE);
+            times[4] = detector.metrics().time(PlaneDetectorMetrics::DELIMIT);
+            for (Plane *plane : planes) delete plane;
+        });
+
+        delete pointCloud;
+    }
+}
+
+void saveCSV(const std::vector<Result> &results, const std::string &fileName)
+{
+    std::ofstream file(fileName);
+    if (!file) throw "Could not open file: " + fileName;
+    file << "name,size,threads,repeats,min,median,mean,max,items_per_second" << std::endl;
+    for (const Result &result : results)
+    {
+        file << result.name << "," << result.size << "," << result.threads << "," << result.times.size() << "," << result.min() << ","
+             << result.median() << "," << result.mean() << "," << result.max() << "," << result.items / result.median() << std::endl;
+    }
+}
+
+void saveJSON(const std::vector<Result> &results, const Options &options, const std::string &fileName)
+{
+    std::ofstream file(fileName);
+    if (!file) throw "Could not open file: " + fileName;
+    file << "{\"seed\":" << options.seed << ",\"repeats\":" << options.repeats << ",\"warmup\":" << options.warmup << ",\"results\":[";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const Result &result = results[i];
+        file << (i > 0 ? "," : "") << "\n{\"name\":\"" << result.name << "\",\"size\":" << result.size << ",\"threads\":" << result.threads
+             << ",\"min\":" << result.min() << ",\"median\":" << result.median() << ",\"mean\":" << result.mean() << ",\"max\":" << result.max()
+             << ",\"items_per_second\":" << result.items / result.median() << ",\"times\":[";
+        for (size_t j = 0; j < result.times.size(); j++)
+        {
+            file << (j > 0 ? "," : "") << result.times[j];
+        }
+        file << "]}";
+    }
+    file << "\n]}" << std::endl;
+}
+
+// compares the medians with the ones of a CSV saved by a previous run, returns the number of regressions
+size_t compareWithBaseline(const std::vector<Result> &results, const std::string &fileName, float threshold)
+{
+    std::ifstream file(fileName);
+    if (!file) throw "Could not open file: " + fileName;
+    std::map<std::string, double> baseline;
+    std::string line;
+    std::getline(file, line);
+    while (std::getline(file, line))
+    {
+        std::vector<std::string> fields;
+        std::istringstream stream(line);
+        std::string field;
+        while (std::getline(stream, field, ',')) fields.push_back(field);
+        if (fields.size() < 6) continue;
+        baseline[fields[0] + "/" + fields[1] + "/" + fields[2]] = std::stod(fields[5]);
+    }
+
+    size_t numRegressions = 0;
+    std::cout << "Comparing with " << fileName << " (threshold " << threshold * 100 << "%)..." << std::endl;
+    for (const Result &result : results)
+    {
+        std::map<std::string, double>::const_iterator it = baseline.find(result.key());
+        if (it == baseline.end()) continue;
+        double change = result.median() / it->second - 1;
+        bool regression = change > threshold;
+        numRegressions += regression;
+        std::cout << (regression ? "REGRESSION " : "           ") << result.key() << ": " << it->second << "s -> "
+                  << result.median() << "s (" << (change >= 0 ? "+" : "") << change * 100 << "%)" << std::endl;
+    }
+    return numRegressions;
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    options.sizes = { 50000 };
+    options.threads = { 1 };
+    options.repeats = 5;
+    options.warmup = 1;
+    options.seed = 42;
+    options.numNormalPoints = 5000;
+    options.threshold = 0.1f;
+    try
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg(argv[i]);
+            if (i + 1 >= argc)
+            {
+                throw "Missing value of " + arg;
+            }
+            std::string value(argv[++i]);
+            if (arg == "--sizes") options.sizes = parseList(value);
+            else if (arg == "--threads") options.threads = parseList(value);
+            else if (arg == "--repeats") options.repeats = std::max<size_t>(1, std::stoul(value));
+            else if (arg == "--warmup") options.warmup = std::stoul(value);
+            else if (arg == "--seed") options.seed = std::stoul(value);
+            else if (arg == "--normal-points") options.numNormalPoints = std::max<size_t>(1, std::stoul(value));
+            else if (arg == "--filter") options.filter = value;
+            else if (arg == "--csv") options.csvFileName = value;
+            else if (arg == "--json") options.jsonFileName = value;
+            else if (arg == "--baseline") options.baselineFileName = value;
+            else if (arg == "--threshold") options.threshold = std::stof(value);
+            else throw "Unknown option: " + arg;
+        }
+    }
+    catch (const std::string &error)
+    {
+        std::cerr << error << std::endl;
+        std::cerr << "Usage: [--sizes <n,n,...>] [--threads <n,n,...>] [--repeats <n>] [--warmup <n>] [--seed <n>] [--normal-points <n>] "
+                     "[--filter <name>] [--csv <file>] [--json <file>] [--baseline <previous csv>] [--threshold <ratio>]" << std::endl;
+        return -1;
+    }
+    catch (const std::exception &)
+    {
+        std::cerr << "Invalid number in the arguments" << std::endl;
+        return -1;
+    }
+
+    try
+    {
+        Benchmark benchmark(options);
+        runBenchmarks(options, benchmark);
+        if (!options.csvFileName.empty()) saveCSV(benchmark.results(), options.csvFileName);
+        if (!options.jsonFileName.empty()) saveJSON(benchmark.results(), options, options.jsonFileName);
+        if (!options.baselineFileName.empty())
+        {
+            size_t numRegressions = compareWithBaseline(benchmark.results(), options.baselineFileName, options.threshold);
+            if (numRegressions > 0)
+            {
+                std::cerr << numRegressions << " regressions above " << options.threshold * 100 << "%" << std::endl;
+                return 1;
+            }
+        }
+    }
+    catch (const std::string &error)
+    {
+        std::cerr << error << std::endl;
+        return -1;
+    }
+    catch (const char *error)
+    {
+        std::cerr << error << std::endl;
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,367 @@
+#include <pointcloud.h>
+#include <inliercodec.h>
+#include <iostream>
+#include <random>
+#include <cstdio>
+
+// Generates synthetic scenes with a known ground truth: random planar rectangles, cylinders and clutter (spheres)
+// inside a cube, plus uniform outliers. The points are streamed to a '.pcl' file and the planes and cylinders,
+// with their inliers, to a '_ground_truth.geo' file, so scenes much larger than the memory can be generated.
+
+struct Options
+{
+    size_t numPlanes;
+    size_t numCylinders;
+    size_t numClutter;
+    float extent;
+    float density;
+    float noise;
+    float outlierRatio;
+    float falloff;
+    unsigned int seed;
+};
+
+// a primitive of the scene and the range of points sampled on it
+struct Shape
+{
+    enum Type
+    {
+        PLANE,
+        CYLINDER,
+        SPHERE
+    };
+
+    Type type;
+    Eigen::Vector3f center;
+    Eigen::Vector3f normal; // the axis of a cylinder
+    Eigen::Vector3f basisU; // half extents of a rectangle
+    Eigen::Vector3f basisV;
+    float radius;
+    float height;
+    Eigen::Vector3f color;
+    size_t firstPoint;
+    size_t numPoints;
+
+    float area() const
+    {
+        switch (type)
+        {
+        case PLANE:
+            return 4 * basisU.norm() * basisV.norm();
+        case CYLINDER:
+            return 2 * float(M_PI) * radius * height;
+        default:
+            return 4 * float(M_PI) * radius * radius;
+        }
+    }
+};
+
+class SceneWriter
+{
+public:
+    SceneWriter(const std::string &filename, const Options &options)
+        : mOptions(options)
+        , mGenerator(options.seed)
+        , mUniform(0, 1)
+        , mNoise(0, options.noise > 0 ? options.noise : 1)
+        , mNumPoints(0)
+    {
+        mFile = fopen(filename.c_str(), "wb");
+        if (mFile == NULL)
+            throw "Could not open file: " + filename;
+        setvbuf(mFile, NULL, _IOFBF, 1 << 22);
+        // the number of points is only known at the end, it is written again then
+        size_t mode = PointCloud3d::NORMAL;
+        fwrite(&mNumPoints, sizeof(size_t), 1, mFile);
+        fwrite(&mode, sizeof(size_t), 1, mFile);
+    }
+
+    ~SceneWriter()
+    {
+        if (mFile != NULL) fclose(mFile);
+    }
+
+    float uniform(float min, float max)
+    {
+        return min + (max - min) * mUniform(mGenerator);
+    }
+
+    Eigen::Vector3f randomDirection()
+    {
+        std::normal_distribution<float> normal(0, 1);
+        Eigen::Vector3f direction;
+        do
+        {
+            direction = Eigen::Vector3f(normal(mGenerator), normal(mGenerator), normal(mGenerator));
+        } while (direction.norm() < 1e-6f);
+        return direction.normalized();
+    }
+
+    Eigen::Vector3f randomPosition(float margin)
+    {
+        float half = mOptions.extent / 2 - margin;
+        return Eigen::Vector3f(uniform(-half, half), uniform(-half, half), uniform(-half, half));
+    }
+
+    void sample(Shape &shape)
+    {
+        shape.firstPoint = mNumPoints;
+        size_t numCandidates = size_t(shape.area() * mOptions.density + 0.5f);
+        for (size_t i = 0; i < numCandidates; i++)
+        {
+            Eigen::Vector3f position, normal;
+            float u = mUniform(mGenerator);
+            float v = mUniform(mGenerator);
+            switch (shape.type)
+            {
+            case Shape::PLANE:
+                normal = shape.normal;
+                position = shape.center + shape.basisU * (2 * u - 1) + shape.basisV * (2 * v - 1);
+                break;
+            case Shape::CYLINDER:
+            {
+                Eigen::Vector3f x = shape.normal.unitOrthogonal();
+                Eigen::Vector3f y = shape.normal.cross(x);
+                float angle = 2 * float(M_PI) * u;
+                normal = x * std::cos(angle) + y * std::sin(angle);
+                position = shape.center + normal * shape.radius + shape.normal * shape.height * (v - 0.5f);
+                break;
+            }
+            case Shape::SPHERE:
+                normal = randomDirection();
+                position = shape.center + normal * shape.radius;
+                break;
+            }
+            if (!isKept(position)) continue;
+            if (mOptions.noise > 0) position += normal * mNoise(mGenerator);
+            write(position, normal);
+        }
+        shape.numPoints = mNumPoints - shape.firstPoint;
+    }
+
+    void addOutliers(size_t numOutliers)
+    {
+        for (size_t i = 0; i < numOutliers; i++)
+        {
+            write(randomPosition(0), randomDirection());
+        }
+    }
+
+    size_t finish()
+    {
+        fseek(mFile, 0, SEEK_SET);
+        fwrite(&mNumPoints, sizeof(size_t), 1, mFile);
+        if (fclose(mFile) != 0)
+        {
+            mFile = NULL;
+            throw "Could not write the point cloud";
+        }
+        mFile = NULL;
+        return mNumPoints;
+    }
+
+private:
+    const Options &mOptions;
+    std::mt19937 mGenerator;
+    std::uniform_real_distribution<float> mUniform;
+    std::normal_distribution<float> mNoise;
+    FILE *mFile;
+    size_t mNumPoints;
+
+    // a scanner at the center of the scene sees the density fall with the square of the distance
+    bool isKept(const Eigen::Vector3f &position)
+    {
+        if (mOptions.falloff <= 0) return true;
+        float distance = position.norm();
+        if (distance <= mOptions.falloff) return true;
+        float ratio = mOptions.falloff / distance;
+        return mUniform(mGenerator) < ratio * ratio;
+    }
+
+    void write(const Eigen::Vector3f &position, const Eigen::Vector3f &normal)
+    {
+        fwrite(position.data(), sizeof(float), 3, mFile);
+        fwrite(normal.data(), sizeof(float), 3, mFile);
+        ++mNumPoints;
+    }
+
+};
+
+// same layout as PointCloudIO::saveGeometry (version 2, without an origin: the scene is generated around zero). the
+// inliers of a shape are consecutive points, so they are written as a single run
+void saveGroundTruth(const std::vector<Shape> &shapes, const std::string &filename)
+{
+    FILE *fp = fopen(filename.c_str(), "wb");
+    if (fp == NULL)
+        throw "Could not open file: " + filename;
+
+    const char magic[6] = { 'G', 'E', 'O', 'I', 'N', 'L' };
+    const uint16_t version = 2;
+    fwrite(magic, 1, sizeof(magic), fp);
+    fwrite(&version, sizeof(uint16_t), 1, fp);
+
+    auto writeInliers = [fp](const Shape &shape) {
+        std::vector<uint8_t> bytes;
+        if (shape.numPoints > 0)
+        {
+            InlierCodec::writeVarint(shape.firstPoint, bytes);
+            InlierCodec::writeVarint(shape.numPoints, bytes);
+        }
+        uint64_t numInliers = shape.numPoints;
+        uint64_t numBytes = bytes.size();
+        uint32_t encoding[2] = { InlierCodec::RANGES, 0 };
+        fwrite(&numInliers, sizeof(uint64_t), 1, fp);
+        fwrite(&numBytes, sizeof(uint64_t), 1, fp);
+        fwrite(encoding, sizeof(uint32_t), 2, fp);
+        fwrite(bytes.data(), 1, bytes.size(), fp);
+    };
+
+    size_t numCircles = 0;
+    fwrite(&numCircles, sizeof(size_t), 1, fp);
+
+    size_t numPlanes = 0;
+    for (const Shape &shape : shapes) numPlanes += shape.type == Shape::PLANE;
+    fwrite(&numPlanes, sizeof(size_t), 1, fp);
+    for (const Shape &shape : shapes)
+    {
+        if (shape.type != Shape::PLANE) continue;
+        fwrite(shape.color.data(), sizeof(float), 3, fp);
+        fwrite(shape.center.data(), sizeof(float), 3, fp);
+        fwrite(shape.normal.data(), sizeof(float), 3, fp);
+        fwrite(shape.basisU.data(), sizeof(float), 3, fp);
+        fwrite(shape.basisV.data(), sizeof(float), 3, fp);
+        writeInliers(shape);
+    }
+
+    size_t numCylinders = 0;
+    for (const Shape &shape : shapes) numCylinders += shape.type == Shape::CYLINDER;
+    fwrite(&numCylinders, sizeof(size_t), 1, fp);
+    for (const Shape &shape : shapes)
+    {
+        if (shape.type != Shape::CYLINDER) continue;
+        fwrite(shape.color.data(), sizeof(float), 3, fp);
+        fwrite(shape.center.data(), sizeof(float), 3, fp);
+        fwrite(shape.normal.data(), sizeof(float), 3, fp);
+        fwrite(&shape.radius, sizeof(float), 1, fp);
+        fwrite(&shape.height, sizeof(float), 1, fp);
+        writeInliers(shape);
+    }
+
+    if (fclose(fp) != 0)
+        throw "Could not write the ground truth: " + filename;
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    options.numPlanes = 10;
+    options.numCylinders = 2;
+    options.numClutter = 5;
+    options.extent = 20;
+    options.density = 100;
+    options.noise = 0.01f;
+    options.outlierRatio = 0.05f;
+    options.falloff = 0;
+    options.seed = 42;
+    std::string outputName;
+    try
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg(argv[i]);
+            if (arg.substr(0, 2) != "--")
+            {
+                outputName = arg;
+                continue;
+            }
+            if (i + 1 >= argc) throw "Missing value of " + arg;
+            std::string value(argv[++i]);
+            if (arg == "--planes") options.numPlanes = std::stoul(value);
+            else if (arg == "--cylinders") options.numCylinders = std::stoul(value);
+            else if (arg == "--clutter") options.numClutter = std::stoul(value);
+            else if (arg == "--extent") options.extent = std::stof(value);
+            else if (arg == "--density") options.density = std::stof(value);
+            else if (arg == "--noise") options.noise = std::stof(value);
+            else if (arg == "--outliers") options.outlierRatio = std::stof(value);
+            else if (arg == "--falloff") options.falloff = std::stof(value);
+            else if (arg == "--seed") options.seed = std::stoul(value);
+            else throw "Unknown option: " + arg;
+        }
+        if (outputName.empty()) throw std::string("Missing output name");
+        if (options.outlierRatio < 0 || options.outlierRatio >= 1) throw std::string("The outlier ratio must be in [0, 1)");
+    }
+    catch (const std::string &error)
+    {
+        std::cerr << error << std::endl;
+        std::cerr << "Usage: <output name> [--planes <n>] [--cylinders <n>] [--clutter <n>] [--extent <scene size>] [--density <points per area unit>] "
+                     "[--noise <sigma>] [--outliers <ratio>] [--falloff <distance>] [--seed <n>]" << std::endl;
+        std::cerr << "Writes <output name>.pcl and <output name>_ground_truth.geo" << std::endl;
+        return -1;
+    }
+    catch (const std::exception &)
+    {
+        std::cerr << "Invalid number in the arguments" << std::endl;
+        return -1;
+    }
+
+    try
+    {
+        SceneWriter writer(outputName + ".pcl", options);
+        std::vector<Shape> shapes;
+        float maxSize = options.extent * 0.3f;
+        for (size_t i = 0; i < options.numPlanes; i++)
+        {
+            Shape shape = Shape();
+            shape.type = Shape::PLANE;
+            shape.center = writer.randomPosition(maxSize / 2);
+            shape.normal = writer.randomDirection();
+            Eigen::Vector3f u = shape.normal.unitOrthogonal();
+            shape.basisU = u * writer.uniform(maxSize / 6, maxSize / 2);
+            shape.basisV = shape.normal.cross(u) * writer.uniform(maxSize / 6, maxSize / 2);
+            shapes.push_back(shape);
+        }
+        for (size_t i = 0; i < options.numCylinders; i++)
+        {
+            Shape shape = Shape();
+            shape.type = Shape::CYLINDER;
+            shape.center = writer.randomPosition(maxSize / 2);
+            shape.normal = writer.randomDirection();
+            shape.radius = writer.uniform(maxSize / 20, maxSize / 6);
+            shape.height = writer.uniform(maxSize / 3, maxSize);
+            shapes.push_back(shape);
+        }
+        for (size_t i = 0; i < options.numClutter; i++)
+        {
+            Shape shape = Shape();
+            shape.type = Shape::SPHERE;
+            shape.center = writer.randomPosition(maxSize / 6);
+            shape.radius = writer.uniform(maxSize / 30, maxSize / 6);
+            shapes.push_back(shape);
+        }
+
+        std::cout << "Sampling " << shapes.size() << " shapes..." << std::endl;
+        for (Shape &shape : shapes)
+        {
+            shape.color = Eigen::Vector3f(writer.uniform(0, 1), writer.uniform(0, 1), writer.uniform(0, 1));
+            writer.sample(shape);
+        }
+        size_t numSurfacePoints = shapes.empty() ? 0 : shapes.back().firstPoint + shapes.back().numPoints;
+        writer.addOutliers(size_t(numSurfacePoints * options.outlierRatio / (1 - options.outlierRatio) + 0.5f));
+        size_t numPoints = writer.finish();
+
+        std::cout << "Saving the ground truth..." << std::endl;
+        saveGroundTruth(shapes, outputName + "_ground_truth.geo");
+        std::cout << numPoints << " points written to " << outputName << ".pcl" << std::endl;
+    }
+    catch (const std::string &error)
+    {
+        std::cerr << error << std::endl;
+        return -1;
+    }
+    catch (const char *error)
+    {
+        std::cerr << error << std::endl;
+        return -1;
+    }
+    return 0;
+}
@@ -1,56 +1,491 @@
 #include <pointcloudio.hpp>
 #include <planedetector.h>
-#include <normalestimator.h>
-#include <boundaryvolumehierarchy.h>
-#include <connectivitygraph.h>
+#include <preprocessing.h>
+#include <perfcounters.h>
+#include <scenecache.h>
+#include <parallel.h>
+#include <boundedqueue.h>
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <cstdlib>
+#include <glob.h>
 
-int main(int argc, char **argv)
+/**
+ * @brief Saves the planes as text. The origin subtracted at loading (see PointCloudIO::origin) is added back
+ * in double, so the centers and vertices are in the coordinates of the input file.
+ */
+template <class Planes>
+void saveText(const Planes &planes, const std::string &filename, const Eigen::Vector3d &origin)
 {
-    if (argc < 3)
+    std::ofstream outputFile(filename);
+    outputFile.precision(std::max<std::streamsize>(outputFile.precision(), origin.isZero() ? 0 : 12));
+    for (Plane *plane : planes)
     {
-        std::cerr << "Usage: <input_point_cloud (XYZ format)> <output file (.txt)>" << std::endl;
-        return -1;
+        Eigen::Vector3d center = plane->center().cast<double>() + origin;
+        Eigen::Vector3d v1 = center + plane->basisU().cast<double>() + plane->basisV().cast<double>();
+        Eigen::Vector3d v2 = center + plane->basisU().cast<double>() - plane->basisV().cast<double>();
+        Eigen::Vector3d v3 = center - plane->basisU().cast<double>() + plane->basisV().cast<double>();
+        Eigen::Vector3d v4 = center - plane->basisU().cast<double>() - plane->basisV().cast<double>();
+        outputFile << "Normal: [" << plane->normal()[0] << ", " << plane->normal()[1] << ", " << plane->normal()[2] << "]; " <<
+                    "Center: [" << center[0] << ", " << center[1] << ", " << center[2] << "]; " <<
+                    "Vertices: [[" << v1.x() << "," << v1.y() << "," << v1.z() << "], " <<
+                                 "[" << v2.x() << "," << v2.y() << "," << v2.z() << "], " << 
+                                 "[" << v3.x() << "," << v3.y() << "," << v3.z() << "], " << 
+                                 "[" << v4.x() << "," << v4.y() << "," << v4.z() << "]]" << std::endl;
+    }
+}
+
+/**
+ * @brief Input files of a batch: each argument is a glob pattern, or '@<file>' for a list of paths (one per line)
+ */
+std::vector<std::string> expandInputs(const std::vector<std::string> &args)
+{
+    std::vector<std::string> inputs;
+    for (const std::string &arg : args)
+    {
+        if (!arg.empty() && arg[0] == '@')
+        {
+            std::ifstream list(arg.substr(1));
+            if (!list.good()) throw "Could not open file: " + arg.substr(1);
+            std::string line;
+            while (std::getline(list, line))
+            {
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                if (!line.empty() && line[0] != '#') inputs.push_back(line);
+            }
+            continue;
+        }
+        // a path that matches nothing is kept, its loading reports the error
+        glob_t matches;
+        if (glob(arg.c_str(), GLOB_NOCHECK, NULL, &matches) == 0)
+        {
+            for (size_t i = 0; i < matches.gl_pathc; i++)
+            {
+                inputs.push_back(matches.gl_pathv[i]);
+            }
+        }
+        globfree(&matches);
+    }
+    return inputs;
+}
+
+/**
+ * @brief Bytes held by the point clouds in flight in a batch. A new point cloud is only loaded while the
+ * total is under the budget, and at least one is always allowed so a point cloud bigger than the budget
+ * still goes through (alone).
+ */
+class MemoryBudget
+{
+public:
+    MemoryBudget(size_t budget)
+        : mBudget(budget)
+        , mBytes(0)
+        , mNumClouds(0)
+    {
+
+    }
+
+    void waitForRoom()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mReleased.wait(lock, [this] { return mNumClouds == 0 || mBytes < mBudget; });
+        mNumClouds++;
+    }
+
+    void add(size_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mBytes += bytes;
+    }
+
+    void release(size_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mBytes -= bytes;
+        mNumClouds--;
+        mReleased.notify_all();
     }
-    std::string inputFileName(argv[1]);
-    std::string outputFileName(argv[2]);
+
+private:
+    size_t mBudget;
+    size_t mBytes;
+    size_t mNumClouds;
+    std::mutex mMutex;
+    std::condition_variable mReleased;
+
+};
+
+struct BatchItem
+{
+    std::string input;
+    std::string output;
+    PointCloud3d *pointCloud;
+    size_t bytes;
+    bool cached;
+    // the key of the input hashes the whole file, it is computed once by the loader
+    SceneCache *cache;
+    Eigen::Vector3d origin;
+    std::vector<int32_t> labels;
+    std::vector<Plane*> planes;
+    double times[4];
+    std::string error;
+};
+
+/**
+ * @brief Detects the planes of many files as a pipeline of four stages (load, normals, detect, save) linked
+ * by small bounded queues. Loading and saving run on their own threads, so the disk works on the next and
+ * previous files while the compute stages work on the current ones; the compute stages have numWorkers
+ * threads each. The memory budget limits the point clouds in flight. A file that fails is reported and
+ * skipped. Returns the number of failed files.
+ */
+size_t runBatch(const std::vector<std::string> &inputs, const std::string &outputDirectory, const std::string &format,
+                size_t numWorkers, size_t memoryBudget, bool useCache, const std::vector<uint8_t> &lasClasses)
+{
+    enum Stage { LOAD, NORMALS, DETECT, SAVE };
+    static const char *stageNames[] = { "load", "normals", "detect", "save" };
+    const size_t normalsNeighborSize = 30;
+    BoundedQueue<BatchItem*> loaded(2), estimated(2), detected(2);
+    MemoryBudget budget(memoryBudget);
+    std::mutex outputMutex;
+    size_t numFailed = 0;
+    double stageTotals[4] = { 0, 0, 0, 0 };
+    std::chrono::steady_clock::time_point batchStart = std::chrono::steady_clock::now();
+
+    // runs one stage of an item, unless an earlier stage failed
+    auto timed = [](BatchItem *item, Stage stage, const std::function<void()> &work) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        if (item->error.empty())
+        {
+            try
+            {
+                work();
+            }
+            catch (const std::string &error)
+            {
+                item->error = error;
+            }
+            catch (const char *error)
+            {
+                item->error = error;
+            }
+            catch (const std::exception &error)
+            {
+                item->error = error.what();
+            }
+            catch (...)
+            {
+                // nothing may escape the thread of a stage
+                item->error = "Unknown error";
+            }
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        item->times[stage] = elapsed.count();
+    };
+
+    std::thread loader([&] {
+        for (const std::string &input : inputs)
+        {
+            budget.waitForRoom();
+            BatchItem *item = new BatchItem();
+            item->input = input;
+            size_t nameStart = input.find_last_of('/') + 1;
+            std::string name = input.substr(nameStart, input.find_last_of('.') > nameStart ? input.find_last_of('.') - nameStart : std::string::npos);
+            item->output = outputDirectory + "/" + name + "." + format;
+            item->pointCloud = NULL;
+            item->bytes = 0;
+            item->cached = false;
+            item->cache = NULL;
+            item->origin = Eigen::Vector3d::Zero();
+            timed(item, LOAD, [&] {
+                PointCloudIO pointCloudIO;
+                pointCloudIO.lasClasses(lasClasses);
+                if (useCache)
+                {
+                    item->cache = new SceneCache(input, Preprocessing::settings(normalsNeighborSize, lasClasses));
+                    if (item->cache->exists())
+                    {
+                        item->pointCloud = pointCloudIO.loadFromPCB(item->cache->filename(), true, false);
+                        item->origin = pointCloudIO.localOrigin(input);
+                        item->pointCloud->geometry()->origin(item->origin);
+                        item->cached = true;
+                    }
+                }
+                if (item->pointCloud == NULL)
+                {
+                    item->pointCloud = pointCloudIO.load(input);
+                    item->origin = pointCloudIO.origin();
+                }
+                item->bytes = item->pointCloud->memoryUsage();
+                budget.add(item->bytes);
+            });
+            loaded.push(item);
+        }
+    });
+
+    auto normalsWorker = [&] {
+        BatchItem *item;
+        while (loaded.pop(item))
+        {
+            timed(item, NORMALS, [&] {
+                if (item->cached) return;
+                Preprocessing::estimateNormals(item->pointCloud, normalsNeighborSize);
+                size_t bytes = item->pointCloud->connectivity()->memoryUsage();
+                item->bytes += bytes;
+                budget.add(bytes);
+            });
+            estimated.push(item);
+        }
+    };
+
+    auto detectWorker = [&] {
+        BatchItem *item;
+        while (estimated.pop(item))
+        {
+            timed(item, DETECT, [&] {
+                PlaneDetector detector(item->pointCloud);
+                detector.minNormalDiff(0.5f);
+                detector.maxDist(0.258819f);
+                detector.outlierRatio(0.75f);
+                if (format == "lbl")
+                {
+                    item->planes = detector.detect(item->labels);
+                }
+                else
+                {
+                    std::set<Plane*> planes = detector.detect();
+                    item->planes.assign(planes.begin(), planes.end());
+                }
+            });
+            detected.push(item);
+        }
+    };
+
+    std::thread saver([&] {
+        BatchItem *item;
+        while (detected.pop(item))
+        {
+            timed(item, SAVE, [&] {
+                PointCloudIO pointCloudIO;
+                Geometry *geometry = item->pointCloud->geometry();
+                for (Plane *plane : item->planes)
+                {
+                    geometry->addPlane(plane);
+                }
+                if (format == "geo")
+                {
+                    pointCloudIO.saveGeometry(geometry, item->output);
+                }
+                else if (format == "lbl")
+                {
+                    pointCloudIO.saveLabels(item->labels, item->output);
+                    pointCloudIO.savePlaneTable(item->planes, item->labels, item->output.substr(0, item->output.size() - 3) + "pln", item->origin);
+                }
+                else
+                {
+                    saveText(item->planes, item->output, item->origin);
+                }
+                if (item->cache != NULL && !item->cached)
+                {
+                    // the planes were added to the geometry, the cache is written without it
+                    geometry->clearPrimitives();
+                    pointCloudIO.saveAsPCB(item->pointCloud, item->cache->temporaryFilename());
+                    if (!item->cache->commit())
+                        throw "Could not save the cache: " + item->cache->filename();
+                }
+            });
+            if (item->pointCloud != NULL)
+            {
+                delete item->pointCloud;
+                budget.release(item->bytes);
+            }
+            else
+            {
+                budget.release(0);
+            }
+
+            std::lock_guard<std::mutex> lock(outputMutex);
+            std::cout << item->input;
+            if (!item->error.empty())
+            {
+                std::cout << ": " << item->error << std::endl;
+                numFailed++;
+            }
+            else
+            {
+                std::cout << " -> " << item->output << ": " << item->planes.size() << " planes";
+                if (item->cached) std::cout << " (cached)";
+                for (size_t stage = 0; stage < 4; stage++)
+                {
+                    std::cout << ", " << stageNames[stage] << " " << item->times[stage] << "s";
+                }
+                std::cout << std::endl;
+            }
+            for (size_t stage = 0; stage < 4; stage++)
+            {
+                stageTotals[stage] += item->times[stage];
+            }
+            delete item->cache;
+            delete item;
+        }
+    });
+
+    // every stage stops once the previous one is done and its queue is empty
+    std::vector<std::thread> normalsWorkers, detectWorkers;
+    for (size_t i = 0; i < numWorkers; i++)
+    {
+        normalsWorkers.push_back(std::thread(normalsWorker));
+        detectWorkers.push_back(std::thread(detectWorker));
+    }
+    loader.join();
+    loaded.close();
+    for (std::thread &worker : normalsWorkers) worker.join();
+    estimated.close();
+    for (std::thread &worker : detectWorkers) worker.join();
+    detected.close();
+    saver.join();
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - batchStart;
+    std::cout << inputs.size() << " files (" << numFailed << " failed) in " << elapsed.count() << "s. Time per stage:";
+    for (size_t stage = 0; stage < 4; stage++)
+    {
+        std::cout << " " << stageNames[stage] << " " << stageTotals[stage] << "s";
+    }
+    std::cout << std::endl;
+    return numFailed;
+}
+
+/**
+ * @brief Detects the planes of a single file (args: input, output and an optional previous detection) and saves
+ * them in the format of the output extension. Errors are thrown, see main.
+ */
+int detectFile(const std::vector<std::string> &args, const std::string &planeTableFileName, bool useCache,
+               const std::vector<uint8_t> &lasClasses, bool countEvents, bool measureMemory)
+{
+    std::string inputFileName(args[0]);
+    std::string outputFileName(args[1]);
+    std::string outputExtension = outputFileName.substr(outputFileName.find_last_of('.') + 1);
 
     std::cout << "Reading the point cloud..." << std::endl;
     PointCloudIO pointCloudIO;
-    // many formats are supported from this class, but XYZ as chosen for being popular and simple
-    PointCloud3d *pointCloud = pointCloudIO.loadFromXYZ(inputFileName);
+    pointCloudIO.lasClasses(lasClasses);
+    size_t normalsNeighborSize = 30;
+    PointCloud3d *pointCloud = NULL;
+    SceneCache *cache = NULL;
+    Eigen::Vector3d origin;
+    if (useCache)
+    {
+        cache = new SceneCache(inputFileName, Preprocessing::settings(normalsNeighborSize, lasClasses));
+        if (cache->exists())
+        {
+            std::cout << "Using the cache " << cache->filename() << std::endl;
+            pointCloud = pointCloudIO.loadFromPCB(cache->filename(), true, false);
+            origin = pointCloudIO.localOrigin(inputFileName);
+            pointCloud->geometry()->origin(origin);
+        }
+    }
+    bool cached = pointCloud != NULL;
+    if (!cached)
+    {
+        // the format is chosen from the extension (XYZ, PTX, PLY, LAS, PCL or PCB), any other is read as XYZ text
+        pointCloud = pointCloudIO.load(inputFileName);
+        origin = pointCloudIO.origin();
+    }
+    if (!origin.isZero())
+    {
+        // georeferenced coordinates are kept relative to a local origin, recorded in the '.geo' and '.pln' outputs
+        // and added back in the '.txt' output
+        std::cout << std::setprecision(12) << "Local origin: " << origin.x() << " " << origin.y() << " " << origin.z()
+                  << std::setprecision(6) << std::endl;
+    }
 
     // you can skip the normal estimation if you point cloud already have normals
-    std::cout << "Estimating normals..." << std::endl;
-    size_t normalsNeighborSize = 30;
-    Octree octree(pointCloud);
-    octree.partition(10, 30);
-    ConnectivityGraph *connectivity = new ConnectivityGraph(pointCloud->size());
-    pointCloud->connectivity(connectivity);
-    NormalEstimator3d estimator(&octree, normalsNeighborSize, NormalEstimator3d::QUICK);
-    std::cout << pointCloud->size() << std::endl;
-    for (size_t i = 0; i < pointCloud->size(); i++)
+    std::chrono::steady_clock::time_point normalsStart = std::chrono::steady_clock::now();
+    PerfCounters::Values normalsStartCounts, normalsEndCounts;
+    if (countEvents) PerfCounters::forThread().read(normalsStartCounts);
+    if (cached)
     {
-        if (i % 10000 == 0)
+        std::cout << pointCloud->size() << std::endl;
+    }
+    else
+    {
+        std::cout << "Estimating normals..." << std::endl;
+        std::cout << pointCloud->size() << std::endl;
+        Preprocessing::estimateNormals(pointCloud, normalsNeighborSize, true);
+    }
+    if (countEvents) PerfCounters::forThread().read(normalsEndCounts);
+    std::chrono::duration<double> normalsElapsed = std::chrono::steady_clock::now() - normalsStart;
+    if (cache != NULL && !cached)
+    {
+        std::cout << "Saving the cache " << cache->filename() << std::endl;
+        try
         {
-            std::cout << i / float(pointCloud->size()) * 100 << "%..." << std::endl;
+            pointCloudIO.saveAsPCB(pointCloud, cache->temporaryFilename());
+            if (!cache->commit())
+                throw "Could not save the cache: " + cache->filename();
+        }
+        catch (const std::string &error)
+        {
+            // the detection does not need the cache, it is only reported
+            std::cerr << error << std::endl;
         }
-        NormalEstimator3d::Normal normal = estimator.estimate(i);
-        connectivity->addNode(i, normal.neighbors);
-        (*pointCloud)[i].normal(normal.normal);
-        (*pointCloud)[i].normalConfidence(normal.confidence);
-        (*pointCloud)[i].curvature(normal.curvature);
     }
+    delete cache;
             
     std::cout << "Detecting planes..." << std::endl;
     PlaneDetector detector(pointCloud);
     detector.minNormalDiff(0.5f);
     detector.maxDist(0.258819f);
     detector.outlierRatio(0.75f);
+    detector.countEvents(countEvents);
+    detector.measureMemory(measureMemory);
 
-    std::set<Plane*> planes = detector.detect();
+    Geometry *seed = NULL;
+    if (args.size() > 2)
+    {
+        // warm start from the planes of a previous frame of the same scene
+        seed = pointCloudIO.loadGeometry(args[2]);
+        if (seed == NULL)
+        {
+            std::cerr << "Could not open file: " << args[2] << std::endl;
+            return -1;
+        }
+        seed->moveOrigin(origin);
+    }
+    std::set<Plane*> planes;
+    // a '.lbl' output only needs the plane of each point, the planes are detected without inlier lists
+    std::vector<int32_t> labels;
+    std::vector<Plane*> labeledPlanes;
+    if (outputExtension == "lbl")
+    {
+        labeledPlanes = detector.detect(labels, seed);
+        planes.insert(labeledPlanes.begin(), labeledPlanes.end());
+    }
+    else if (seed != NULL)
+    {
+        planes = detector.detect(seed);
+    }
+    else
+    {
+        planes = detector.detect();
+    }
+    delete seed;
     std::cout << planes.size() << std::endl;
+    std::cout << "normal_estimation - Time elapsed: " << normalsElapsed.count() << "s (" << pointCloud->size() << " points)";
+    for (size_t i = 0; i < PerfCounters::NUM_EVENTS; i++)
+    {
+        if (!countEvents || !PerfCounters::forThread().available(PerfCounters::Event(i))) continue;
+        std::cout << ", " << PerfCounters::eventName(PerfCounters::Event(i)) << ": " << normalsEndCounts.counts[i] - normalsStartCounts.counts[i];
+    }
+    std::cout << std::endl;
+    detector.metrics().print(std::cout);
 
     std::cout << "Saving results..." << std::endl;
     Geometry *geometry = pointCloud->geometry();
@@ -58,23 +493,165 @@ int main(int argc, char **argv)
     {
         geometry->addPlane(plane);
     }
-    // many output formats are allowed. if you want to run our 'compare_plane_detector', uncomment the line below and comment the rest
-    //pointCloudIO.saveGeometry(geometry, outputFileName);
-    std::ofstream outputFile(outputFileName + ".txt");
-    for (Plane *plane : planes)
+    // many output formats are allowed. a '.geo' output can be used by 'compare_plane_detector' and 'merge_planes'
+    if (outputExtension == "geo")
     {
-        Eigen::Vector3f v1 = plane->center() + plane->basisU() + plane->basisV();
-        Eigen::Vector3f v2 = plane->center() + plane->basisU() - plane->basisV();
-        Eigen::Vector3f v3 = plane->center() - plane->basisU() + plane->basisV();
-        Eigen::Vector3f v4 = plane->center() - plane->basisU() - plane->basisV(); 
-        outputFile << "Normal: [" << plane->normal()[0] << ", " << plane->normal()[1] << ", " << plane->normal()[2] << "]; " <<
-                    "Center: [" << plane->center()[0] << ", " << plane->center()[1] << ", " << plane->center()[2] << "]; " <<
-                    "Vertices: [[" << v1.x() << "," << v1.y() << "," << v1.z() << "], " <<
-                                 "[" << v2.x() << "," << v2.y() << "," << v2.z() << "], " << 
-                                 "[" << v3.x() << "," << v3.y() << "," << v3.z() << "], " << 
-                                 "[" << v4.x() << "," << v4.y() << "," << v4.z() << "]]" << std::endl;
+        pointCloudIO.saveGeometry(geometry, outputFileName);
+    }
+    else if (outputExtension == "lbl")
+    {
+        pointCloudIO.saveLabels(labels, outputFileName);
+        if (!planeTableFileName.empty())
+        {
+            pointCloudIO.savePlaneTable(labeledPlanes, labels, planeTableFileName, origin);
+        }
+    }
+    else
+    {
+        saveText(planes, outputFileName + ".txt", origin);
     }
 
     delete pointCloud;
     return 0;
+}
+
+int main(int argc, char **argv)
+{
+    // --trace <file.json> saves a Chrome trace (chrome://tracing, Perfetto) of the whole run
+    // --counters adds the hardware counters of each stage to the report
+    // --memory adds the bytes held by each subsystem at the end of every detection phase
+    // --planes <file.pln> saves the plane table that goes with a '.lbl' output
+    // --cache keeps the point cloud with its normals and connectivity next to the input, so the next runs on the
+    // same file skip straight to the detection
+    // --classes <c1,c2,...> only loads the points of these classifications from '.las' files
+    // --batch <output directory> processes every input (glob patterns or '@<list file>') as a pipeline, see runBatch
+    std::vector<std::string> args;
+    std::string traceFileName;
+    std::string planeTableFileName;
+    std::string batchDirectory;
+    std::string batchFormat = "geo";
+    size_t batchWorkers = std::max<size_t>(1, Parallel::numThreads() / 2);
+    size_t batchMemory = size_t(2048) << 20;
+    bool countEvents = false;
+    bool measureMemory = false;
+    bool useCache = false;
+    std::vector<uint8_t> lasClasses;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::string(argv[i]) == "--trace" && i + 1 < argc)
+        {
+            traceFileName = argv[++i];
+        }
+        else if (std::string(argv[i]) == "--planes" && i + 1 < argc)
+        {
+            planeTableFileName = argv[++i];
+        }
+        else if (std::string(argv[i]) == "--counters")
+        {
+            countEvents = true;
+        }
+        else if (std::string(argv[i]) == "--memory")
+        {
+            measureMemory = true;
+        }
+        else if (std::string(argv[i]) == "--cache")
+        {
+            useCache = true;
+        }
+        else if (std::string(argv[i]) == "--classes" && i + 1 < argc)
+        {
+            std::istringstream classes(argv[++i]);
+            std::string classification;
+            while (std::getline(classes, classification, ','))
+            {
+                lasClasses.push_back(uint8_t(std::strtoul(classification.c_str(), NULL, 10)));
+            }
+        }
+        else if (std::string(argv[i]) == "--batch" && i + 1 < argc)
+        {
+            batchDirectory = argv[++i];
+        }
+        else if (std::string(argv[i]) == "--format" && i + 1 < argc)
+        {
+            batchFormat = argv[++i];
+        }
+        else if (std::string(argv[i]) == "--workers" && i + 1 < argc)
+        {
+            batchWorkers = std::max<size_t>(1, std::strtoul(argv[++i], NULL, 10));
+        }
+        else if (std::string(argv[i]) == "--memory-mb" && i + 1 < argc)
+        {
+            batchMemory = std::strtoul(argv[++i], NULL, 10) << 20;
+        }
+        else
+        {
+            args.push_back(argv[i]);
+        }
+    }
+    if (!batchDirectory.empty())
+    {
+        if (args.empty() || (batchFormat != "geo" && batchFormat != "lbl" && batchFormat != "txt"))
+        {
+            std::cerr << "Usage: --batch <output directory> [--format geo|lbl|txt] [--workers <n>] [--memory-mb <n>] [--cache] [--classes <c1,c2,...>] [--trace <trace (.json)>] <input patterns or @<list file>...>" << std::endl;
+            return -1;
+        }
+        Trace::enable(!traceFileName.empty());
+        size_t numFailed;
+        try
+        {
+            numFailed = runBatch(expandInputs(args), batchDirectory, batchFormat, batchWorkers, batchMemory, useCache, lasClasses);
+        }
+        catch (const std::string &error)
+        {
+            std::cerr << error << std::endl;
+            return -1;
+        }
+        catch (const char *error)
+        {
+            std::cerr << error << std::endl;
+            return -1;
+        }
+        catch (const std::exception &error)
+        {
+            std::cerr << error.what() << std::endl;
+            return -1;
+        }
+        if (!traceFileName.empty() && !Trace::save(traceFileName))
+        {
+            std::cerr << "Could not save the trace: " << traceFileName << std::endl;
+        }
+        return numFailed > 0 ? 1 : 0;
+    }
+    if (args.size() < 2)
+    {
+        std::cerr << "Usage: [--trace <trace (.json)>] [--counters] [--memory] [--cache] [--classes <c1,c2,...>] [--planes <plane table (.pln)>] <input_point_cloud (XYZ, PTX, PLY, LAS, PCL or PCB format)> <output file (.txt, .geo or .lbl)> [previous detection (.geo)]" << std::endl;
+        return -1;
+    }
+    Trace::enable(!traceFileName.empty());
+    int result;
+    try
+    {
+        result = detectFile(args, planeTableFileName, useCache, lasClasses, countEvents, measureMemory);
+    }
+    catch (const std::string &error)
+    {
+        std::cerr << error << std::endl;
+        return -1;
+    }
+    catch (const char *error)
+    {
+        std::cerr << error << std::endl;
+        return -1;
+    }
+    catch (const std::exception &error)
+    {
+        std::cerr << error.what() << std::endl;
+        return -1;
+    }
+
+    if (!traceFileName.empty() && !Trace::save(traceFileName))
+    {
+        std::cerr << "Could not save the trace: " << traceFileName << std::endl;
+    }
+    return result;
 }
\ No newline at end of file
@@ -0,0 +1,56 @@
+#include <pointcloudio.hpp>
+#include <planemerger.h>
+#include <iostream>
+#include <chrono>
+
+int main(int argc, char **argv)
+{
+    if (argc < 5 || (argc - 3) % 2 != 0)
+    {
+        std::cerr << "Usage: <global point cloud> <output geometry (.geo)> <shard geometry (.geo)> <shard indices (.idx)> [<shard geometry (.geo)> <shard indices (.idx)> ...]" << std::endl;
+        return -1;
+    }
+    std::string inputFileName(argv[1]);
+    std::string outputFileName(argv[2]);
+
+    try
+    {
+        std::cout << "Reading the point cloud..." << std::endl;
+        PointCloudIO pointCloudIO;
+        PointCloud3d *pointCloud = pointCloudIO.load(inputFileName);
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        PlaneMerger merger(pointCloud);
+        for (int i = 3; i < argc; i += 2)
+        {
+            Geometry *geometry = pointCloudIO.loadGeometry(argv[i]);
+            if (geometry == NULL)
+                throw "Could not open file: " + std::string(argv[i]);
+            merger.addGeometry(geometry, pointCloudIO.loadIndices(argv[i + 1]));
+            delete geometry;
+        }
+        size_t numShardPlanes = merger.numPlanes();
+
+        std::cout << "Merging planes..." << std::endl;
+        Geometry *geometry = merger.merge();
+        std::chrono::duration<float> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << numShardPlanes << " shard planes merged into " << geometry->numPlanes() << " planes in " << elapsed.count() << "s" << std::endl;
+
+        std::cout << "Saving results..." << std::endl;
+        pointCloudIO.saveGeometry(geometry, outputFileName);
+
+        delete geometry;
+        delete pointCloud;
+    }
+    catch (const std::string &error)
+    {
+        std::cerr << error << std::endl;
+        return -1;
+    }
+    catch (const char *error)
+    {
+        std::cerr << error << std::endl;
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,485 @@
+#include <pointcloudio.hpp>
+#include <planedetector.h>
+#include <preprocessing.h>
+#include <parallel.h>
+#include <boundedqueue.h>
+#include <iostream>
+#include <sstream>
+#include <chrono>
+#include <atomic>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+// Job server: listens on a Unix domain socket and detects the planes of the point clouds it is sent, so a
+// pipeline pays the process start-up once and scans processed again (e.g. with other parameters) skip the
+// loading and the normal estimation. The protocol is one text line per request and one text line per reply:
+//
+//   detect <input> <output (.geo or .lbl)> [min_normal_diff=<v>] [max_dist=<v>] [outlier_ratio=<v>] [planes=<file.pln>]
+//     -> ok planes=<n> cached=<0|1> wait=<s> load=<s> detect=<s> save=<s> total=<s> queue=<depth>
+//   status
+//     -> ok queue=<depth> running=<n> done=<n> failed=<n> scenes=<n> cache_bytes=<bytes> budget=<bytes>
+//   shutdown
+//     -> ok
+//
+// Errors are replied as "error <message>", a full queue as "error queue full". Paths cannot hold spaces. A
+// connection waits for its job before reading the next line, clients wanting several jobs in flight open
+// several connections.
+
+struct Job
+{
+    std::string input;
+    std::string output;
+    std::string planeTable;
+    float minNormalDiff;
+    float maxDist;
+    float outlierRatio;
+    std::chrono::steady_clock::time_point queued;
+    std::promise<std::string> reply;
+};
+
+/**
+ * @brief Point clouds with their normals and connectivity, kept by recency of use under a memory budget. A
+ * scene is identified by its path, size and modification time, so a rewritten file is loaded again. Workers
+ * asking for a scene being loaded wait for it instead of loading it twice. The detections only read the point
+ * clouds, so jobs share them; an evicted scene is freed when its last job is done.
+ */
+class SceneLRU
+{
+public:
+    typedef std::shared_ptr<const PointCloud3d> Scene;
+
+    SceneLRU(size_t budget)
+        : mBudget(budget)
+        , mBytes(0)
+    {
+
+    }
+
+    /**
+     * @brief The scene of the file, loaded with load(filename) if it is not cached
+     */
+    template <class Loader>
+    Scene get(const std::string &filename, bool &cached, const Loader &load)
+    {
+        struct stat status;
+        if (stat(filename.c_str(), &status) != 0) throw "Could not open file: " + filename;
+        std::ostringstream key;
+        key << filename << ":" << status.st_size << ":" << status.st_mtime;
+
+        std::shared_ptr<std::promise<Scene> > loading;
+        std::shared_future<Scene> scene;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            std::unordered_map<std::string, Entry>::iterator it = mEntries.find(key.str());
+            if (it != mEntries.end())
+            {
+                mRecency.splice(mRecency.begin(), mRecency, it->second.recency);
+                scene = it->second.scene;
+            }
+            else
+            {
+                loading = std::make_shared<std::promise<Scene> >();
+                Entry &entry = mEntries[key.str()];
+                entry.scene = loading->get_future().share();
+                entry.bytes = 0;
+                mRecency.push_front(key.str());
+                entry.recency = mRecency.begin();
+                scene = entry.scene;
+            }
+        }
+        cached = loading == NULL;
+        if (cached) return scene.get();
+
+        try
+        {
+            Scene loaded(load(filename));
+            std::lock_guard<std::mutex> lock(mMutex);
+            std::unordered_map<std::string, Entry>::iterator it = mEntries.find(key.str());
+            if (it != mEntries.end())
+            {
+                it->second.bytes = loaded->memoryUsage() + loaded->connectivity()->memoryUsage();
+                mBytes += it->second.bytes;
+            }
+            loading->set_value(loaded);
+            evict();
+        }
+        catch (...)
+        {
+            // the waiting workers get the error too, and the next request tries again
+            std::lock_guard<std::mutex> lock(mMutex);
+            mRecency.erase(mEntries[key.str()].recency);
+            mEntries.erase(key.str());
+            loading->set_exception(std::current_exception());
+        }
+        return scene.get();
+    }
+
+    size_t numScenes()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mEntries.size();
+    }
+
+    size_t bytes()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mBytes;
+    }
+
+    size_t budget() const
+    {
+        return mBudget;
+    }
+
+private:
+    struct Entry
+    {
+        std::shared_future<Scene> scene;
+        size_t bytes;
+        std::list<std::string>::iterator recency;
+    };
+
+    size_t mBudget;
+    size_t mBytes;
+    std::unordered_map<std::string, Entry> mEntries;
+    std::list<std::string> mRecency;
+    std::mutex mMutex;
+
+    /**
+     * @brief Drops the least recently used loaded scenes until the budget is met, always keeping the most recent
+     */
+    void evict()
+    {
+        std::list<std::string>::iterator it = mRecency.end();
+        while (mBytes > mBudget && it != mRecency.begin())
+        {
+            --it;
+            if (it == mRecency.begin()) break;
+            Entry &entry = mEntries[*it];
+            // scenes being loaded have no size yet
+            if (entry.bytes == 0) continue;
+            mBytes -= entry.bytes;
+            mEntries.erase(*it);
+            it = mRecency.erase(it);
+        }
+    }
+
+};
+
+PointCloud3d* loadScene(const std::string &filename)
+{
+    PointCloudIO pointCloudIO;
+    PointCloud3d *pointCloud = pointCloudIO.load(filename);
+    Preprocessing::estimateNormals(pointCloud);
+    return pointCloud;
+}
+
+class Server
+{
+public:
+    Server(size_t queueCapacity, size_t cacheBudget)
+        : mQueue(queueCapacity)
+        , mScenes(cacheBudget)
+        , mListener(-1)
+        , mStopping(false)
+        , mNumRunning(0)
+        , mNumDone(0)
+        , mNumFailed(0)
+    {
+
+    }
+
+    void run(const std::string &socketPath, size_t numWorkers)
+    {
+        mListener = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (mListener < 0) throw std::string("Could not create the socket");
+        sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (socketPath.size() >= sizeof(address.sun_path)) throw "Socket path too long: " + socketPath;
+        strcpy(address.sun_path, socketPath.c_str());
+        unlink(socketPath.c_str());
+        if (bind(mListener, (sockaddr*)&address, sizeof(address)) != 0 || listen(mListener, 64) != 0)
+        {
+            close(mListener);
+            throw "Could not listen on " + socketPath;
+        }
+        std::cout << "Listening on " << socketPath << " (" << numWorkers << " workers)" << std::endl;
+
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < numWorkers; i++)
+        {
+            workers.push_back(std::thread(&Server::work, this));
+        }
+        std::vector<std::thread> connections;
+        for (;;)
+        {
+            int client = accept(mListener, NULL, NULL);
+            if (client < 0)
+            {
+                if (mStopping) break;
+                continue;
+            }
+            std::lock_guard<std::mutex> lock(mMutex);
+            mClients.insert(client);
+            connections.push_back(std::thread(&Server::serve, this, client));
+        }
+
+        // the queued jobs are still done, then the idle connections are woken up (only their reading side is
+        // shut down, so the last replies still go out)
+        mQueue.close();
+        for (std::thread &worker : workers)
+        {
+            worker.join();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            for (const int &client : mClients)
+            {
+                ::shutdown(client, SHUT_RD);
+            }
+        }
+        for (std::thread &connection : connections)
+        {
+            connection.join();
+        }
+        close(mListener);
+        unlink(socketPath.c_str());
+    }
+
+private:
+    BoundedQueue<std::shared_ptr<Job> > mQueue;
+    SceneLRU mScenes;
+    int mListener;
+    std::atomic<bool> mStopping;
+    std::atomic<size_t> mNumRunning;
+    std::atomic<size_t> mNumDone;
+    std::atomic<size_t> mNumFailed;
+    std::set<int> mClients;
+    std::mutex mMutex;
+
+    void serve(int client)
+    {
+        std::string buffer;
+        char data[4096];
+        bool open = true;
+        while (open)
+        {
+            size_t end;
+            while ((end = buffer.find('\n')) == std::string::npos)
+            {
+                ssize_t size = recv(client, data, sizeof(data), 0);
+                if (size <= 0)
+                {
+                    open = false;
+                    break;
+                }
+                buffer.append(data, size);
+            }
+            if (!open) break;
+            std::string line = buffer.substr(0, end);
+            buffer.erase(0, end + 1);
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty()) continue;
+            std::string reply = handle(line) + "\n";
+            open = send(client, reply.data(), reply.size(), MSG_NOSIGNAL) == ssize_t(reply.size());
+        }
+        std::lock_guard<std::mutex> lock(mMutex);
+        mClients.erase(client);
+        close(client);
+    }
+
+    std::string handle(const std::string &line)
+    {
+        std::istringstream stream(line);
+        std::string command;
+        stream >> command;
+        std::ostringstream reply;
+        if (command == "status")
+        {
+            reply << "ok queue=" << mQueue.size() << " running=" << mNumRunning << " done=" << mNumDone << " failed=" << mNumFailed
+                  << " scenes=" << mScenes.numScenes() << " cache_bytes=" << mScenes.bytes() << " budget=" << mScenes.budget();
+            return reply.str();
+        }
+        if (command == "shutdown")
+        {
+            mStopping = true;
+            ::shutdown(mListener, SHUT_RDWR);
+            return "ok";
+        }
+        if (command != "detect") return "error unknown command: " + command;
+
+        std::shared_ptr<Job> job = std::make_shared<Job>();
+        job->minNormalDiff = 0.5f;
+        job->maxDist = 0.258819f;
+        job->outlierRatio = 0.75f;
+        if (!(stream >> job->input >> job->output)) return std::string("error usage: detect <input> <output> [name=value ...]");
+        std::string option;
+        try
+        {
+            while (stream >> option)
+            {
+                size_t separator = option.find('=');
+                std::string name = option.substr(0, separator);
+                std::string value = separator != std::string::npos ? option.substr(separator + 1) : "";
+                if (name == "min_normal_diff") job->minNormalDiff = std::stof(value);
+                else if (name == "max_dist") job->maxDist = std::stof(value);
+                else if (name == "outlier_ratio") job->outlierRatio = std::stof(value);
+                else if (name == "planes") job->planeTable = value;
+                else return "error unknown option: " + name;
+            }
+        }
+        catch (const std::exception &)
+        {
+            return "error invalid value: " + option;
+        }
+        std::string extension = job->output.substr(job->output.find_last_of('.') + 1);
+        if (extension != "geo" && extension != "lbl") return "error the output must be a .geo or .lbl file: " + job->output;
+
+        std::future<std::string> result = job->reply.get_future();
+        job->queued = std::chrono::steady_clock::now();
+        if (mStopping || !mQueue.tryPush(job)) return mStopping ? "error shutting down" : "error queue full";
+        return result.get();
+    }
+
+    void work()
+    {
+        std::shared_ptr<Job> job;
+        while (mQueue.pop(job))
+        {
+            mNumRunning++;
+            std::string reply;
+            try
+            {
+                reply = detect(*job);
+                mNumDone++;
+            }
+            catch (const std::string &error)
+            {
+                reply = "error " + error;
+                mNumFailed++;
+            }
+            catch (const std::exception &error)
+            {
+                reply = std::string("error ") + error.what();
+                mNumFailed++;
+            }
+            mNumRunning--;
+            std::cout << job->input << " -> " << job->output << ": " << reply << std::endl;
+            job->reply.set_value(reply);
+        }
+    }
+
+    std::string detect(const Job &job)
+    {
+        typedef std::chrono::steady_clock Clock;
+        Clock::time_point start = Clock::now();
+        bool cached;
+        SceneLRU::Scene pointCloud = mScenes.get(job.input, cached, loadScene);
+        Clock::time_point loaded = Clock::now();
+
+        PlaneDetector detector(pointCloud.get());
+        detector.minNormalDiff(job.minNormalDiff);
+        detector.maxDist(job.maxDist);
+        detector.outlierRatio(job.outlierRatio);
+        PointCloudIO pointCloudIO;
+        size_t numPlanes;
+        Clock::time_point detected;
+        if (job.output.substr(job.output.find_last_of('.') + 1) == "lbl")
+        {
+            // only the plane of each point is needed, the planes are detected without inlier lists
+            std::vector<int32_t> labels;
+            std::vector<Plane*> planes = detector.detect(labels);
+            detected = Clock::now();
+            numPlanes = planes.size();
+            pointCloudIO.saveLabels(labels, job.output);
+            if (!job.planeTable.empty()) pointCloudIO.savePlaneTable(planes, labels, job.planeTable, pointCloud->geometry()->origin());
+            for (Plane *plane : planes) delete plane;
+        }
+        else
+        {
+            std::set<Plane*> planes = detector.detect();
+            detected = Clock::now();
+            numPlanes = planes.size();
+            // the geometry deletes the planes
+            Geometry geometry;
+            geometry.origin(pointCloud->geometry()->origin());
+            for (Plane *plane : planes)
+            {
+                geometry.addPlane(plane);
+            }
+            pointCloudIO.saveGeometry(&geometry, job.output);
+        }
+        Clock::time_point saved = Clock::now();
+
+        std::ostringstream reply;
+        reply << "ok planes=" << numPlanes << " cached=" << cached
+              << " wait=" << std::chrono::duration<double>(start - job.queued).count()
+              << " load=" << std::chrono::duration<double>(loaded - start).count()
+              << " detect=" << std::chrono::duration<double>(detected - loaded).count()
+              << " save=" << std::chrono::duration<double>(saved - detected).count()
+              << " total=" << std::chrono::duration<double>(saved - job.queued).count()
+              << " queue=" << mQueue.size();
+        return reply.str();
+    }
+
+};
+
+int main(int argc, char **argv)
+{
+    std::string socketPath;
+    size_t numWorkers = Parallel::numThreads();
+    size_t queueCapacity = 64;
+    size_t cacheBudget = size_t(1) << 30;
+    try
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg(argv[i]);
+            if (arg.substr(0, 2) != "--")
+            {
+                socketPath = arg;
+                continue;
+            }
+            if (i + 1 >= argc) throw "Missing value of " + arg;
+            std::string value(argv[++i]);
+            if (arg == "--workers") numWorkers = std::max<size_t>(1, std::stoul(value));
+            else if (arg == "--queue") queueCapacity = std::max<size_t>(1, std::stoul(value));
+            else if (arg == "--cache-mb") cacheBudget = std::stoul(value) << 20;
+            else throw "Unknown option: " + arg;
+        }
+        if (socketPath.empty()) throw std::string("Missing socket path");
+    }
+    catch (const std::string &error)
+    {
+        std::cerr << error << std::endl;
+        std::cerr << "Usage: <socket path> [--workers <n>] [--queue <max queued jobs>] [--cache-mb <scene cache budget in MB>]" << std::endl;
+        return -1;
+    }
+    catch (const std::exception &)
+    {
+        std::cerr << "Invalid number in the arguments" << std::endl;
+        return -1;
+    }
+
+    try
+    {
+        Server server(queueCapacity, cacheBudget);
+        server.run(socketPath, numWorkers);
+    }
+    catch (const std::string &error)
+    {
+        std::cerr << error << std::endl;
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,214 @@
+#ifndef ASCIIPARSER_H
+#define ASCIIPARSER_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "parallel.h"
+#include "trace.h"
+
+/**
+ * @brief Parser of ASCII point clouds (one point per line, columns separated by spaces, tabs or commas).
+ * The text is split in chunks aligned on line breaks, which are parsed concurrently. Numbers are parsed
+ * without the C library, so the result does not depend on the locale.
+ */
+class AsciiParser
+{
+public:
+    static const size_t MAX_COLUMNS = 64;
+
+    /**
+     * @brief Parses a decimal number ("-1.5", "2", ".5e-3", ...) starting at p and moves p past it.
+     * Returns false (leaving p untouched) if there is no number at p.
+     */
+    inline static bool parseFloat(const char *&p, const char *end, float &value)
+    {
+        static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                         1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+        const char *s = p;
+        bool negative = false;
+        if (s < end && (*s == '-' || *s == '+'))
+        {
+            negative = *s == '-';
+            s++;
+        }
+        // at most 19 significant digits fit in the mantissa, the others only scale it
+        uint64_t mantissa = 0;
+        int exponent = 0;
+        int significantDigits = 0;
+        bool hasDigits = false;
+        for (; s < end && isDigit(*s); s++, hasDigits = true)
+        {
+            if (significantDigits < 19)
+            {
+                mantissa = mantissa * 10 + (*s - '0');
+                if (mantissa != 0) significantDigits++;
+            }
+            else
+            {
+                exponent++;
+            }
+        }
+        if (s < end && *s == '.')
+        {
+            for (s++; s < end && isDigit(*s); s++, hasDigits = true)
+            {
+                if (significantDigits < 19)
+                {
+                    mantissa = mantissa * 10 + (*s - '0');
+                    if (mantissa != 0) significantDigits++;
+                    exponent--;
+                }
+            }
+        }
+        if (!hasDigits) return false;
+        if (s < end && (*s == 'e' || *s == 'E'))
+        {
+            const char *e = s + 1;
+            bool negativeExponent = false;
+            if (e < end && (*e == '-' || *e == '+'))
+            {
+                negativeExponent = *e == '-';
+                e++;
+            }
+            if (e < end && isDigit(*e))
+            {
+                int explicitExponent = 0;
+                for (; e < end && isDigit(*e); e++)
+                {
+                    if (explicitExponent < 100000) explicitExponent = explicitExponent * 10 + (*e - '0');
+                }
+                exponent += negativeExponent ? -explicitExponent : explicitExponent;
+                s = e;
+            }
+        }
+        double result = double(mantissa);
+        if (exponent < 0 && exponent >= -22)
+            result /= powers[-exponent];
+        else if (exponent > 0 && exponent <= 22)
+            result *= powers[exponent];
+        else if (exponent != 0)
+            result *= std::pow(10.0, exponent);
+        value = float(negative ? -result : result);
+        p = s;
+        return true;
+    }
+
+    /**
+     * @brief Parses the numbers of the line starting at p (at most maxValues) and moves p to the next line.
+     * Parsing stops at the first token that is not a number. Returns the number of values parsed.
+     */
+    inline static size_t parseLine(const char *&p, const char *end, float *values, size_t maxValues)
+    {
+        size_t numValues = 0;
+        while (numValues < maxValues)
+        {
+            while (p < end && (*p == ' ' || *p == '\t' || *p == ',' || *p == ';')) p++;
+            if (p == end || *p == '\n' || *p == '\r' || !parseFloat(p, end, values[numValues])) break;
+            numValues++;
+        }
+        p = skipLines(p, end, 1);
+        return numValues;
+    }
+
+    /**
+     * @brief Returns the start of the line numLines lines after p (or end)
+     */
+    inline static const char* skipLines(const char *p, const char *end, size_t numLines)
+    {
+        for (size_t i = 0; i < numLines && p < end; i++)
+        {
+            const char *lineEnd = static_cast<const char*>(memchr(p, '\n', end - p));
+            p = lineEnd != NULL ? lineEnd + 1 : end;
+        }
+        return p;
+    }
+
+    /**
+     * @brief Parses all the lines of text into rows. For each line, convert(values, numValues, row) is
+     * called with the numbers of the line and returns false if the line is not a row (e.g. too few columns).
+     * Each chunk is converted by its own copy of convert, which are returned (in text order) so state
+     * gathered while converting can be combined by the caller. rows is sized once, from the line count.
+     */
+    template <class Row, class Convert>
+    static std::vector<Convert> parse(const char *text, size_t size, size_t maxColumns, std::vector<Row> &rows, const Convert &convert)
+    {
+        if (maxColumns > MAX_COLUMNS) maxColumns = MAX_COLUMNS;
+        std::vector<std::pair<const char*, const char*> > chunks = split(text, size);
+        std::vector<Convert> converters(chunks.size(), convert);
+
+        // counts the lines first, so every chunk knows where its rows start
+        std::vector<size_t> offsets(chunks.size() + 1, 0);
+        Parallel::run(chunks.size(), [&](size_t c) {
+            size_t numLines = 0;
+            for (const char *p = chunks[c].first; p < chunks[c].second; numLines++)
+            {
+                p = skipLines(p, chunks[c].second, 1);
+            }
+            offsets[c + 1] = numLines;
+        });
+        for (size_t c = 0; c < chunks.size(); c++)
+        {
+            offsets[c + 1] += offsets[c];
+        }
+        rows.resize(offsets.back());
+
+        std::vector<size_t> numRows(chunks.size(), 0);
+        Parallel::run(chunks.size(), [&](size_t c) {
+            TraceScope trace("AsciiParser::chunk");
+            float values[MAX_COLUMNS];
+            Row *out = rows.data() + offsets[c];
+            for (const char *p = chunks[c].first; p < chunks[c].second;)
+            {
+                size_t numValues = parseLine(p, chunks[c].second, values, maxColumns);
+                if (converters[c](values, numValues, *out)) out++;
+            }
+            numRows[c] = out - (rows.data() + offsets[c]);
+        });
+
+        // closes the gaps left by the lines that were not rows
+        size_t numTotal = numRows[0];
+        for (size_t c = 1; c < chunks.size(); c++)
+        {
+            if (numTotal != offsets[c])
+            {
+                std::move(rows.begin() + offsets[c], rows.begin() + offsets[c] + numRows[c], rows.begin() + numTotal);
+            }
+            numTotal += numRows[c];
+        }
+        rows.resize(numTotal);
+        return converters;
+    }
+
+private:
+    static const size_t MIN_CHUNK_SIZE = 1 << 20;
+
+    inline static bool isDigit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    static std::vector<std::pair<const char*, const char*> > split(const char *text, size_t size)
+    {
+        size_t numChunks = std::max<size_t>(1, std::min(Parallel::numThreads(), size / MIN_CHUNK_SIZE));
+        std::vector<std::pair<const char*, const char*> > chunks;
+        const char *end = text + size;
+        const char *begin = text;
+        for (size_t c = 1; c <= numChunks && begin < end; c++)
+        {
+            const char *chunkEnd = c == numChunks ? end : text + size / numChunks * c;
+            if (chunkEnd < begin) chunkEnd = begin;
+            chunkEnd = skipLines(chunkEnd, end, 1);
+            chunks.push_back(std::make_pair(begin, chunkEnd));
+            begin = chunkEnd;
+        }
+        if (chunks.empty()) chunks.push_back(std::make_pair(text, text));
+        return chunks;
+    }
+
+};
+
+#endif // ASCIIPARSER_H
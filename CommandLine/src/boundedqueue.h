@@ -0,0 +1,81 @@
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+/**
+ * @brief FIFO with a maximum size, shared by producer and consumer threads. push() waits while the queue is
+ * full (tryPush() does not), pop() waits while it is empty. Once closed, nothing more can be pushed and pop()
+ * returns false after the remaining items.
+ */
+template <class T>
+class BoundedQueue
+{
+public:
+    BoundedQueue(size_t capacity)
+        : mCapacity(capacity)
+        , mClosed(false)
+    {
+
+    }
+
+    bool push(const T &item)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mNotFull.wait(lock, [this] { return mClosed || mItems.size() < mCapacity; });
+        if (mClosed) return false;
+        mItems.push_back(item);
+        mNotEmpty.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief Returns false without waiting if the queue is full or closed
+     */
+    bool tryPush(const T &item)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mClosed || mItems.size() >= mCapacity) return false;
+        mItems.push_back(item);
+        mNotEmpty.notify_one();
+        return true;
+    }
+
+    bool pop(T &item)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mNotEmpty.wait(lock, [this] { return mClosed || !mItems.empty(); });
+        if (mItems.empty()) return false;
+        item = mItems.front();
+        mItems.pop_front();
+        mNotFull.notify_one();
+        return true;
+    }
+
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mClosed = true;
+        mNotEmpty.notify_all();
+        mNotFull.notify_all();
+    }
+
+    size_t size()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mItems.size();
+    }
+
+private:
+    size_t mCapacity;
+    bool mClosed;
+    std::deque<T> mItems;
+    std::mutex mMutex;
+    std::condition_variable mNotEmpty;
+    std::condition_variable mNotFull;
+
+};
+
+#endif // BOUNDEDQUEUE_H
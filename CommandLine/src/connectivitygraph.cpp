@@ -1,5 +1,7 @@
 #include "connectivitygraph.h"
 
+#include <limits>
+
 ConnectivityGraph::ConnectivityGraph(size_t numNodes)
     : mGroupInitialized(false)
 {
@@ -14,6 +16,68 @@ void ConnectivityGraph::addNode(size_t node, const std::vector<size_t> &neighbor
     mGraph.insert(mGraph.end(), neighbors.begin(), neighbors.end());
 }
 
+void ConnectivityGraph::setEdges(const std::vector<size_t> &offsets, std::vector<size_t> &&neighbors)
+{
+    mGraph = std::move(neighbors);
+    for (size_t i = 0; i < mGraphIndices.size(); i++)
+    {
+        mGraphIndices[i].first = offsets[i];
+        mGraphIndices[i].second = offsets[i + 1] - offsets[i];
+    }
+}
+
+void ConnectivityGraph::removeNodes(const std::vector<size_t> &nodes)
+{
+    const size_t removed = std::numeric_limits<size_t>::max();
+    std::vector<size_t> newIndices(mGraphIndices.size(), 0);
+    for (const size_t &node : nodes)
+    {
+        newIndices[node] = removed;
+    }
+    size_t numNodes = 0;
+    for (size_t i = 0; i < newIndices.size(); i++)
+    {
+        if (newIndices[i] != removed)
+        {
+            newIndices[i] = numNodes++;
+        }
+    }
+    std::vector<size_t> graph;
+    graph.reserve(mGraph.size());
+    std::vector<std::pair<size_t, size_t> > graphIndices(numNodes);
+    std::vector<size_t> groupIndices(numNodes, 0);
+    for (size_t i = 0; i < newIndices.size(); i++)
+    {
+        if (newIndices[i] == removed) continue;
+        size_t node = newIndices[i];
+        graphIndices[node].first = graph.size();
+        for (size_t j = mGraphIndices[i].first; j < mGraphIndices[i].first + mGraphIndices[i].second; j++)
+        {
+            if (newIndices[mGraph[j]] != removed)
+            {
+                graph.push_back(newIndices[mGraph[j]]);
+            }
+        }
+        graphIndices[node].second = graph.size() - graphIndices[node].first;
+        groupIndices[node] = mGroupIndices[i];
+    }
+    mGraph = graph;
+    mGraphIndices = graphIndices;
+    mGroupIndices = groupIndices;
+    for (std::pair<const size_t, std::vector<size_t> > &group : mGroups)
+    {
+        std::vector<size_t> points;
+        for (const size_t &point : group.second)
+        {
+            if (newIndices[point] != removed)
+            {
+                points.push_back(newIndices[point]);
+            }
+        }
+        group.second = points;
+    }
+}
+
 void ConnectivityGraph::setGroupIndices(const std::vector<size_t> &indices)
 {
     mGroupInitialized = true;
@@ -5,11 +5,13 @@
 #include "plane.h"
 #include "cylinder.h"
 #include "connection.h"
+#include "memoryusage.h"
 
 class Geometry
 {
 public:
     Geometry()
+        : mOrigin(Eigen::Vector3d::Zero())
     {
 
     }
@@ -19,6 +21,38 @@ public:
         clearPrimitives();
     }
 
+    /**
+     * @brief Origin the coordinates of the primitives are relative to, e.g. the local origin of a '.las' file
+     * (see PointCloudIO::origin). Zero by default.
+     */
+    const Eigen::Vector3d& origin() const
+    {
+        return mOrigin;
+    }
+
+    void origin(const Eigen::Vector3d &origin)
+    {
+        mOrigin = origin;
+    }
+
+    /**
+     * @brief Expresses the planes and cylinders relative to another origin (the circles are 2D, they are left as
+     * they are)
+     */
+    void moveOrigin(const Eigen::Vector3d &origin)
+    {
+        Eigen::Vector3f offset = (mOrigin - origin).cast<float>();
+        for (Plane *plane : mPlanes)
+        {
+            plane->center(plane->center() + offset);
+        }
+        for (Cylinder *cylinder : mCylinders)
+        {
+            cylinder->center(cylinder->center() + offset);
+        }
+        mOrigin = origin;
+    }
+
     void addCircle(Circle *circle)
     {
         mCircles.push_back(circle);
@@ -147,7 +181,29 @@ public:
         clearCylinders();
     }
 
+    /**
+     * @brief Bytes held by the primitives and their inliers
+     */
+    size_t memoryUsage() const
+    {
+        size_t bytes = MemoryUsage::of(mCircles) + MemoryUsage::of(mPlanes) + MemoryUsage::of(mCylinders) + MemoryUsage::of(mConnections);
+        for (const Circle *circle : mCircles)
+        {
+            bytes += sizeof(Circle) + MemoryUsage::of(circle->inliers());
+        }
+        for (const Plane *plane : mPlanes)
+        {
+            bytes += sizeof(Plane) + MemoryUsage::of(plane->inliers());
+        }
+        for (const Cylinder *cylinder : mCylinders)
+        {
+            bytes += sizeof(Cylinder) + MemoryUsage::of(cylinder->inliers());
+        }
+        return bytes + mConnections.size() * sizeof(Connection);
+    }
+
 private:
+    Eigen::Vector3d mOrigin;
     std::vector<Circle*> mCircles;
     std::vector<Plane*> mPlanes;
     std::vector<Cylinder*> mCylinders;
@@ -0,0 +1,153 @@
+#ifndef GRIDNORMALESTIMATOR_H
+#define GRIDNORMALESTIMATOR_H
+
+#include <algorithm>
+
+#include "pointcloud.h"
+#include "normalestimator.h"
+
+/**
+ * @brief Normal estimation for organized point clouds. The neighbors of a point are taken from a window
+ * of the scan grid around it instead of a kNN search, so neither an octree nor any search is needed and
+ * the cost is linear in the number of points. Neighbors whose range (distance to the scanner) differs too
+ * much from the range of the point are rejected, so windows crossing a depth discontinuity do not mix
+ * surfaces. Like the kNN estimation, the normal is fitted to the numNeighbors nearest neighbors, taken from
+ * the smallest window holding at least that many cells.
+ */
+class GridNormalEstimator
+{
+public:
+    GridNormalEstimator(PointCloud3d *pointCloud, size_t numNeighbors = 30, float maxRangeDiff = 0.05f)
+        : mPointCloud(pointCloud)
+        , mNumNeighbors(numNeighbors)
+        , mWindowRadius(windowRadiusFor(numNeighbors))
+        , mMaxRangeDiff(maxRangeDiff)
+    {
+
+    }
+
+    /**
+     * @brief Smallest window radius whose window has numNeighbors cells around its center (3 for 30)
+     */
+    static size_t windowRadiusFor(size_t numNeighbors)
+    {
+        size_t radius = 1;
+        while ((2 * radius + 1) * (2 * radius + 1) - 1 < numNeighbors) radius++;
+        return radius;
+    }
+
+    size_t numNeighbors() const
+    {
+        return mNumNeighbors;
+    }
+
+    size_t windowRadius() const
+    {
+        return mWindowRadius;
+    }
+
+    void windowRadius(size_t windowRadius)
+    {
+        mWindowRadius = windowRadius;
+    }
+
+    /**
+     * @brief Maximum range difference to a neighbor, relative to the range of the point
+     */
+    float maxRangeDiff() const
+    {
+        return mMaxRangeDiff;
+    }
+
+    void maxRangeDiff(float maxRangeDiff)
+    {
+        mMaxRangeDiff = maxRangeDiff;
+    }
+
+    /**
+     * @brief Estimates the normal of the point in the given cell (which must not be empty). The neighbors
+     * are sorted by distance and the normal is oriented towards the scanner.
+     */
+    NormalEstimator3d::Normal estimate(const ScanGrid &scan, size_t row, size_t column) const
+    {
+        NormalEstimator3d::Normal normal;
+        normal.point = scan.at(row, column);
+        normal.normal = Eigen::Vector3f::Zero();
+        normal.curvature = 0;
+        normal.confidence = 0;
+
+        const Eigen::Vector3f &position = mPointCloud->at(normal.point).position();
+        float range = (position - scan.origin()).norm();
+        std::vector<std::pair<size_t, float> > neighbors;
+        size_t firstRow = row > mWindowRadius ? row - mWindowRadius : 0;
+        size_t firstColumn = column > mWindowRadius ? column - mWindowRadius : 0;
+        for (size_t c = firstColumn; c <= column + mWindowRadius && c < scan.width(); c++)
+        {
+            for (size_t r = firstRow; r <= row + mWindowRadius && r < scan.height(); r++)
+            {
+                size_t neighbor = scan.at(r, c);
+                if (neighbor == ScanGrid::NONE || neighbor == normal.point) continue;
+                const Eigen::Vector3f &neighborPosition = mPointCloud->at(neighbor).position();
+                if (std::abs((neighborPosition - scan.origin()).norm() - range) > mMaxRangeDiff * range) continue;
+                neighbors.push_back(std::make_pair(neighbor, (neighborPosition - position).squaredNorm()));
+            }
+        }
+        std::sort(neighbors.begin(), neighbors.end(), [](const std::pair<size_t, float> &a, const std::pair<size_t, float> &b) {
+            return a.second < b.second;
+        });
+        if (neighbors.size() > mNumNeighbors) neighbors.resize(mNumNeighbors);
+        for (const std::pair<size_t, float> &neighbor : neighbors)
+        {
+            normal.neighbors.push_back(neighbor.first);
+        }
+        if (neighbors.size() < 2) return normal;
+
+        Eigen::Matrix<float, 3, -1> matrix(3, neighbors.size() + 1);
+        matrix.col(0) = position;
+        for (size_t i = 0; i < neighbors.size(); i++)
+        {
+            matrix.col(i + 1) = mPointCloud->at(neighbors[i].first).position();
+        }
+        Eigen::Matrix3f eigenVectors;
+        Eigen::Vector3f eigenValues;
+        PCACalculator<3>::calculate(matrix, eigenVectors, eigenValues);
+
+        normal.normal = eigenVectors.col(2).normalized();
+        if (normal.normal.dot(scan.origin() - position) < 0) normal.normal = -normal.normal;
+        normal.curvature = eigenValues(2) / eigenValues.array().sum();
+        normal.confidence = eigenValues(0) / (eigenValues(2) + 1e-4);
+        return normal;
+    }
+
+    /**
+     * @brief Estimates the normals of all the points of the scans, storing them in the point cloud and the
+     * neighbors in connectivity
+     */
+    void estimate(ConnectivityGraph *connectivity)
+    {
+        for (const ScanGrid &scan : mPointCloud->scans())
+        {
+            for (size_t column = 0; column < scan.width(); column++)
+            {
+                for (size_t row = 0; row < scan.height(); row++)
+                {
+                    if (scan.at(row, column) == ScanGrid::NONE) continue;
+                    NormalEstimator3d::Normal normal = estimate(scan, row, column);
+                    connectivity->addNode(normal.point, normal.neighbors);
+                    (*mPointCloud)[normal.point].normal(normal.normal);
+                    (*mPointCloud)[normal.point].normalConfidence(normal.confidence);
+                    (*mPointCloud)[normal.point].curvature(normal.curvature);
+                }
+            }
+        }
+    }
+
+private:
+    PointCloud3d *mPointCloud;
+    size_t mNumNeighbors;
+    size_t mWindowRadius;
+    float mMaxRangeDiff;
+
+};
+
+#endif // GRIDNORMALESTIMATOR_H
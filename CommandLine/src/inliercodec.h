@@ -0,0 +1,215 @@
+#ifndef INLIERCODEC_H
+#define INLIERCODEC_H
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Compact encoding of the inliers of a primitive, used by the '.geo' files. The indices are sorted and
+ * stored either as varint deltas (the gap to the previous index) or as runs of consecutive indices (the gap to
+ * the end of the previous run and the run length, both varints), whichever is smaller. Runs are much smaller
+ * when the points of a primitive are stored together, e.g. after a spatial reordering.
+ */
+class InlierCodec
+{
+public:
+    enum Encoding
+    {
+        DELTAS = 0,
+        RANGES = 1
+    };
+
+    /**
+     * @brief Encodes the inliers (in any order) into bytes, returning the encoding used
+     */
+    static Encoding encode(const std::vector<size_t> &inliers, std::vector<uint8_t> &bytes)
+    {
+        std::vector<size_t> sorted(inliers);
+        std::sort(sorted.begin(), sorted.end());
+
+        size_t deltasSize = 0;
+        size_t rangesSize = 0;
+        bool hasDuplicates = false;
+        size_t previous = 0;
+        size_t runEnd = 0;
+        for (size_t i = 0; i < sorted.size(); i++)
+        {
+            deltasSize += varintSize(sorted[i] - previous);
+            previous = sorted[i];
+            if (i > 0 && sorted[i] == sorted[i - 1]) hasDuplicates = true;
+            if (i == 0 || sorted[i] != sorted[i - 1] + 1)
+            {
+                size_t runStart = sorted[i];
+                size_t length = runLength(sorted, i);
+                rangesSize += varintSize(runStart - runEnd) + varintSize(length);
+                runEnd = runStart + length;
+            }
+        }
+
+        bytes.clear();
+        if (hasDuplicates || deltasSize <= rangesSize)
+        {
+            bytes.reserve(deltasSize);
+            previous = 0;
+            for (size_t index : sorted)
+            {
+                writeVarint(index - previous, bytes);
+                previous = index;
+            }
+            return DELTAS;
+        }
+        bytes.reserve(rangesSize);
+        runEnd = 0;
+        for (size_t i = 0; i < sorted.size(); i += runLength(sorted, i))
+        {
+            size_t length = runLength(sorted, i);
+            writeVarint(sorted[i] - runEnd, bytes);
+            writeVarint(length, bytes);
+            runEnd = sorted[i] + length;
+        }
+        return RANGES;
+    }
+
+    /**
+     * @brief Streaming decoder: yields the numInliers indices one at a time, in increasing order, without
+     * materializing them
+     */
+    class Decoder
+    {
+    public:
+        Decoder(const uint8_t *data, size_t size, Encoding encoding, size_t numInliers)
+            : mData(data)
+            , mEnd(data + size)
+            , mEncoding(encoding)
+            , mRemaining(numInliers)
+            , mCurrent(0)
+            , mRunRemaining(0)
+        {
+
+        }
+
+        size_t remaining() const
+        {
+            return mRemaining;
+        }
+
+        bool next(size_t &index)
+        {
+            if (mRemaining == 0) return false;
+            if (mEncoding == DELTAS)
+            {
+                mCurrent += readVarint();
+                index = mCurrent;
+            }
+            else
+            {
+                if (mRunRemaining == 0)
+                {
+                    mCurrent += readVarint();
+                    mRunRemaining = readVarint();
+                    if (mRunRemaining == 0)
+                        throw std::string("Corrupted inlier ranges");
+                }
+                index = mCurrent++;
+                mRunRemaining--;
+            }
+            mRemaining--;
+            return true;
+        }
+
+    private:
+        const uint8_t *mData;
+        const uint8_t *mEnd;
+        Encoding mEncoding;
+        size_t mRemaining;
+        size_t mCurrent;
+        size_t mRunRemaining;
+
+        size_t readVarint()
+        {
+            return InlierCodec::readVarint(mData, mEnd);
+        }
+
+    };
+
+    /**
+     * @brief Decodes numInliers indices. The count comes from the file, so it is checked against the bytes before
+     * anything is allocated: every delta takes a byte at least, and the runs have to add up to it.
+     */
+    static void decode(const uint8_t *data, size_t size, Encoding encoding, size_t numInliers, std::vector<size_t> &inliers)
+    {
+        if (encoding == DELTAS ? numInliers > size : numInliers != numRangeInliers(data, size))
+            throw std::string("Corrupted inlier encoding");
+        inliers.resize(numInliers);
+        Decoder decoder(data, size, encoding, numInliers);
+        for (size_t i = 0; i < numInliers; i++)
+        {
+            decoder.next(inliers[i]);
+        }
+    }
+
+    /**
+     * @brief Appends value to bytes, 7 bits per byte (the high bit marks that more bytes follow)
+     */
+    inline static void writeVarint(size_t value, std::vector<uint8_t> &bytes)
+    {
+        for (; value >= 0x80; value >>= 7)
+        {
+            bytes.push_back(uint8_t(value | 0x80));
+        }
+        bytes.push_back(uint8_t(value));
+    }
+
+private:
+    static size_t readVarint(const uint8_t *&data, const uint8_t *end)
+    {
+        size_t value = 0;
+        for (size_t shift = 0; ; shift += 7)
+        {
+            if (data == end || shift >= 64)
+                throw std::string("Corrupted inlier encoding");
+            uint8_t byte = *data++;
+            value |= size_t(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) return value;
+        }
+    }
+
+    // sum of the run lengths of RANGES bytes
+    static size_t numRangeInliers(const uint8_t *data, size_t size)
+    {
+        const uint8_t *end = data + size;
+        size_t numInliers = 0;
+        while (data != end)
+        {
+            readVarint(data, end);
+            size_t length = readVarint(data, end);
+            if (length > std::numeric_limits<size_t>::max() - numInliers)
+                throw std::string("Corrupted inlier ranges");
+            numInliers += length;
+        }
+        return numInliers;
+    }
+
+    inline static size_t varintSize(size_t value)
+    {
+        size_t size = 1;
+        for (; value >= 0x80; value >>= 7) size++;
+        return size;
+    }
+
+    /**
+     * @brief Number of consecutive indices starting at sorted[i]
+     */
+    inline static size_t runLength(const std::vector<size_t> &sorted, size_t i)
+    {
+        size_t length = 1;
+        while (i + length < sorted.size() && sorted[i + length] == sorted[i] + length) length++;
+        return length;
+    }
+
+};
+
+#endif // INLIERCODEC_H
@@ -0,0 +1,39 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Runs independent jobs on their own threads, the calling thread running the first one
+ */
+class Parallel
+{
+public:
+    static size_t numThreads()
+    {
+        return std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+
+    /**
+     * @brief Calls job(i) for i in [0, numJobs) and returns when all of them are done
+     */
+    template <class Job>
+    static void run(size_t numJobs, const Job &job)
+    {
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < numJobs; i++)
+        {
+            workers.push_back(std::thread(job, i));
+        }
+        if (numJobs > 0) job(0);
+        for (std::thread &worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+};
+
+#endif // PARALLEL_H
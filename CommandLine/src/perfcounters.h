@@ -0,0 +1,152 @@
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include <cstdint>
+#include <cstring>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+/**
+ * @brief Hardware counters of the calling thread read through perf_event_open (Linux only).
+ * Each counter is opened on its own, so the ones the kernel or the CPU refuses (perf_event_paranoid,
+ * containers, virtual machines) are simply reported as unavailable. Counts are scaled when the kernel
+ * multiplexes the counters.
+ */
+class PerfCounters
+{
+public:
+    enum Event
+    {
+        CYCLES = 0,
+        INSTRUCTIONS = 1,
+        LLC_MISSES = 2,
+        BRANCH_MISSES = 3,
+        NUM_EVENTS = 4
+    };
+
+    struct Values
+    {
+        uint64_t counts[NUM_EVENTS];
+
+        Values()
+        {
+            clear();
+        }
+
+        void clear()
+        {
+            for (size_t i = 0; i < NUM_EVENTS; i++)
+            {
+                counts[i] = 0;
+            }
+        }
+    };
+
+    PerfCounters()
+    {
+        for (size_t i = 0; i < NUM_EVENTS; i++)
+        {
+            mFds[i] = open(Event(i));
+        }
+    }
+
+    ~PerfCounters()
+    {
+#ifdef __linux__
+        for (size_t i = 0; i < NUM_EVENTS; i++)
+        {
+            if (mFds[i] != -1) close(mFds[i]);
+        }
+#endif
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    /**
+     * @brief Counters of the calling thread, opened on its first call
+     */
+    static PerfCounters& forThread()
+    {
+        static thread_local PerfCounters counters;
+        return counters;
+    }
+
+    static const char* eventName(Event event)
+    {
+        static const char *names[NUM_EVENTS] = { "cycles", "instructions", "llc_misses", "branch_misses" };
+        return names[event];
+    }
+
+    bool available(Event event) const
+    {
+        return mFds[event] != -1;
+    }
+
+    bool available() const
+    {
+        for (size_t i = 0; i < NUM_EVENTS; i++)
+        {
+            if (available(Event(i))) return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief Counts since the counters were opened. Take two readings and subtract them to count a section.
+     */
+    void read(Values &values) const
+    {
+        for (size_t i = 0; i < NUM_EVENTS; i++)
+        {
+            values.counts[i] = read(mFds[i]);
+        }
+    }
+
+private:
+    int mFds[NUM_EVENTS];
+
+    static int open(Event event)
+    {
+#ifdef __linux__
+        static const uint64_t configs[NUM_EVENTS] = { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                                      PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[event];
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        long fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+        return fd < 0 ? -1 : int(fd);
+#else
+        (void)event;
+        return -1;
+#endif
+    }
+
+    static uint64_t read(int fd)
+    {
+#ifdef __linux__
+        if (fd == -1) return 0;
+        uint64_t data[3]; // value, time enabled, time running
+        if (::read(fd, data, sizeof(data)) != sizeof(data) || data[2] == 0) return 0;
+        if (data[2] == data[1]) return data[0];
+        return uint64_t(double(data[0]) * data[1] / data[2]);
+#else
+        (void)fd;
+        return 0;
+#endif
+    }
+
+};
+
+#endif // PERFCOUNTERS_H
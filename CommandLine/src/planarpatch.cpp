@@ -12,6 +12,7 @@ PlanarPatch::PlanarPatch(const PointCloud3d *pointCloud, StatisticsUtils *statis
     , mOriginalSize(getSize())
     , mNumNewPoints(0)
     , mNumUpdates(0)
+    , mNumMerges(0)
     , mStable(false)
     , mMinAllowedNormal(minAllowedNormal)
     , mMaxAllowedDist(maxAllowedDist)
@@ -162,7 +163,7 @@ void PlanarPatch::update()
         mUsedVisited2 = true;
     }
     if (mUsedVisited2) {
-        if (mVisited2.empty()) {
+        if (mVisited2.size() != mPointCloud->size()) {
             mVisited2 = std::vector<bool>(mPointCloud->size(), false);
         } else {
             std::fill(mVisited2.begin(), mVisited2.end(), false);
@@ -181,7 +182,7 @@ void PlanarPatch::updatePlane()
         mUsedVisited2 = true;
     }
     if (mUsedVisited2) {
-        if (mVisited2.empty()) {
+        if (mVisited2.size() != mPointCloud->size()) {
             mVisited2 = std::vector<bool>(mPointCloud->size(), false);
         } else {
             std::fill(mVisited2.begin(), mVisited2.end(), false);
@@ -177,6 +177,14 @@ public:
         return mNumUpdates;
     }
 
+    /**
+     * @brief Number of other patches merged into this one
+     */
+    size_t& numMerges()
+    {
+        return mNumMerges;
+    }
+
     size_t originalSize() const
     {
         return mOriginalSize;
@@ -186,6 +194,14 @@ public:
 
     float getSize() const;
 
+    /**
+     * @brief Bytes held by the points, the visited sets and the outlier cache (the statistics buffers are shared)
+     */
+    size_t memoryUsage() const
+    {
+        return sizeof(*this) + MemoryUsage::of(mPoints) + MemoryUsage::of(mVisited) + MemoryUsage::of(mVisited2) + MemoryUsage::of(mOutliers);
+    }
+
 private:
     const PointCloud3d *mPointCloud;
     StatisticsUtils *mStatistics;
@@ -198,6 +214,7 @@ private:
     RotatedRect mRect;
     size_t mNumNewPoints;
     size_t mNumUpdates;
+    size_t mNumMerges;
     std::unordered_set<size_t> mVisited;
     std::vector<bool> mVisited2;
     std::unordered_map<size_t, bool> mOutliers;
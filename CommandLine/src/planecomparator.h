@@ -0,0 +1,113 @@
+#ifndef PLANECOMPARATOR_H
+#define PLANECOMPARATOR_H
+
+#include <vector>
+
+#include "pointcloud.h"
+#include "planemetrics.h"
+
+/**
+ * @brief Scores detected planes against a ground truth with the metrics of ComparePlaneDetector (see
+ * PlaneMetrics, the same implementation). The octree leaves and the ground truth planes of every point are
+ * computed once, so many detections of the same scene can be scored cheaply. Scoring is single threaded, many
+ * detections are meant to be scored concurrently.
+ */
+class PlaneComparator
+{
+public:
+    struct Score
+    {
+        float precision;
+        float recall;
+        float f1;
+        size_t numCorrect;
+        size_t numGroundTruth;
+    };
+
+    PlaneComparator(const PointCloud3d *pointCloud, const Geometry *groundTruth, size_t maxLevel = 9)
+        : mLeaves(pointCloud->size(), [pointCloud](size_t i) { return pointCloud->at(i).position().data(); }, maxLevel)
+        , mGroundTruth(pointCloud->size(), groundTruth->numPlanes(), [groundTruth](size_t i) -> const std::vector<size_t>& {
+              return groundTruth->plane(i)->inliers();
+          })
+        , mGroundTruthNormals(normalsOf(groundTruth))
+    {
+
+    }
+
+    size_t numLeaves() const
+    {
+        return mLeaves.numLeaves();
+    }
+
+    /**
+     * @brief Scores a detection given as the plane of every point (-1 for none), like the output of
+     * PlaneDetector::detect(std::vector<int32_t>&)
+     */
+    Score compare(std::vector<int32_t> labels, const std::vector<Plane*> &planes) const
+    {
+        labels.resize(mGroundTruth.numPoints(), -1);
+        PlaneMetrics::Labels test(labels, planes.size());
+        std::vector<size_t> sizes(planes.size(), 0);
+        for (const uint32_t &plane : test.planes)
+        {
+            sizes[plane]++;
+        }
+        return score(test, planes, sizes);
+    }
+
+    /**
+     * @brief Scores the planes of a geometry
+     */
+    Score compare(const Geometry *geometry) const
+    {
+        std::vector<Plane*> planes;
+        std::vector<size_t> sizes;
+        for (size_t i = 0; i < geometry->numPlanes(); i++)
+        {
+            planes.push_back(geometry->plane(i));
+            sizes.push_back(geometry->plane(i)->inliers().size());
+        }
+        PlaneMetrics::Labels test(mGroundTruth.numPoints(), planes.size(), [&planes](size_t i) -> const std::vector<size_t>& {
+            return planes[i]->inliers();
+        });
+        return score(test, planes, sizes);
+    }
+
+private:
+    PlaneMetrics::Leaves mLeaves;
+    PlaneMetrics::Labels mGroundTruth;
+    std::vector<float> mGroundTruthNormals;
+
+    template <class Planes>
+    static std::vector<float> normalsOf(const Planes &planes, size_t numPlanes)
+    {
+        std::vector<float> normals;
+        for (size_t i = 0; i < numPlanes; i++)
+        {
+            const Eigen::Vector3f &normal = planes(i)->normal();
+            normals.insert(normals.end(), normal.data(), normal.data() + 3);
+        }
+        return normals;
+    }
+
+    static std::vector<float> normalsOf(const Geometry *geometry)
+    {
+        return normalsOf([geometry](size_t i) { return geometry->plane(i); }, geometry->numPlanes());
+    }
+
+    Score score(const PlaneMetrics::Labels &test, const std::vector<Plane*> &planes, const std::vector<size_t> &sizes) const
+    {
+        std::vector<float> normals = normalsOf([&planes](size_t i) { return planes[i]; }, planes.size());
+        PlaneMetrics::Score metrics = PlaneMetrics::score(mLeaves, mGroundTruth, test, mGroundTruthNormals, normals, sizes, 1);
+        Score score;
+        score.precision = metrics.precision;
+        score.recall = metrics.recall;
+        score.f1 = metrics.f1;
+        score.numCorrect = metrics.numCorrect;
+        score.numGroundTruth = mGroundTruthNormals.size() / 3;
+        return score;
+    }
+
+};
+
+#endif // PLANECOMPARATOR_H
@@ -0,0 +1 @@
+#include "planedetectormetrics.h"
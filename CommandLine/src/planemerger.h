@@ -0,0 +1,73 @@
+#ifndef PLANEMERGER_H
+#define PLANEMERGER_H
+
+#include "pointcloud.h"
+#include "planeindex.h"
+
+/**
+ * @brief Fuses the plane sets detected independently on shards of a point cloud.
+ * Each shard geometry comes with the mapping from its point indices to the indices of
+ * the global point cloud. Coplanar planes of different shards whose rectangles touch
+ * are merged and re-delimited with PlaneDetector::delimitPlane. The shard planes are moved to the
+ * origin of the global point cloud (see Geometry::origin), the merged geometry is relative to it.
+ */
+class PlaneMerger
+{
+public:
+    PlaneMerger(const PointCloud3d *pointCloud);
+
+    ~PlaneMerger();
+
+    void addGeometry(const Geometry *geometry, const std::vector<size_t> &indices);
+
+    Geometry* merge();
+
+    size_t numPlanes() const
+    {
+        return mPlanes.size();
+    }
+
+    float minNormalDiff() const
+    {
+        return mMinNormalDiff;
+    }
+
+    void minNormalDiff(float minNormalDiff)
+    {
+        mMinNormalDiff = minNormalDiff;
+    }
+
+    float maxDist() const
+    {
+        return mMaxDist;
+    }
+
+    void maxDist(float maxDist)
+    {
+        mMaxDist = maxDist;
+    }
+
+    float maxGap() const
+    {
+        return mMaxGap;
+    }
+
+    void maxGap(float maxGap)
+    {
+        mMaxGap = maxGap;
+    }
+
+private:
+    const PointCloud3d *mPointCloud;
+    std::vector<Plane*> mPlanes;
+    std::vector<size_t> mShards;
+    size_t mNumShards;
+    float mMinNormalDiff;
+    float mMaxDist;
+    float mMaxGap;
+
+    bool isCoplanar(const Plane *a, const Plane *b, float maxDist) const;
+
+};
+
+#endif // PLANEMERGER_H
@@ -0,0 +1,347 @@
+#ifndef PLANEMETRICS_H
+#define PLANEMETRICS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief The metrics of ComparePlaneDetector, also used by PlaneComparator so a detection scored by the sweep
+ * gets the same score as with ComparePlaneDetector. Each test plane corresponds to the ground truth plane holding
+ * most of its inliers (counting the first ground truth plane of each point), if that is at least half of them
+ * and the normals are within 30 degrees. Precision and recall are then counted in the leaves of an octree, not
+ * in points, so dense regions do not dominate. This only depends on the standard library.
+ */
+class PlaneMetrics
+{
+public:
+    // at most maxThreads threads (0 for one per core), with enough work for each
+    static size_t numThreadsFor(size_t size, size_t maxThreads)
+    {
+        if (maxThreads == 0) maxThreads = std::thread::hardware_concurrency();
+        return std::max<size_t>(1, std::min<size_t>(maxThreads, size / 10000));
+    }
+
+    // runs f(begin, end, thread) on contiguous ranges of [0, size), one per thread
+    template <class F>
+    static void parallelFor(size_t size, size_t maxThreads, const F &f)
+    {
+        size_t numThreads = numThreadsFor(size, maxThreads);
+        std::vector<std::thread> threads;
+        for (size_t t = 1; t < numThreads; t++)
+        {
+            threads.push_back(std::thread(f, size * t / numThreads, size * (t + 1) / numThreads, t));
+        }
+        f(0, size / numThreads, 0);
+        for (std::thread &thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    /**
+     * @brief Leaf of every point in an octree of the bounding cube subdivided maxLevel + 1 times (the empty cells
+     * are not subdivided, which does not change the leaf of any point), numbered densely
+     */
+    class Leaves
+    {
+    public:
+        /**
+         * @param position
+         *      position(i) gives the 3 coordinates of the point i
+         */
+        template <class Position>
+        Leaves(size_t numPoints, const Position &position, size_t maxLevel, size_t maxThreads = 0)
+        {
+            float min[3], max[3];
+            std::fill(min, min + 3, std::numeric_limits<float>::max());
+            std::fill(max, max + 3, -std::numeric_limits<float>::max());
+            for (size_t i = 0; i < numPoints; i++)
+            {
+                const float *p = position(i);
+                for (size_t d = 0; d < 3; d++)
+                {
+                    min[d] = std::min(min[d], p[d]);
+                    max[d] = std::max(max[d], p[d]);
+                }
+            }
+            float center[3] = { (min[0] + max[0]) / 2, (min[1] + max[1]) / 2, (min[2] + max[2]) / 2 };
+            float size = std::max(max[0] - min[0], std::max(max[1] - min[1], max[2] - min[2])) / 2;
+            size_t numLevels = std::min<size_t>(maxLevel + 1, 21);
+
+            // the path of every point, 3 bits per level, with the float arithmetic of the recursive subdivision
+            std::vector<uint64_t> keys(numPoints);
+            parallelFor(numPoints, maxThreads, [&](size_t begin, size_t end, size_t) {
+                for (size_t i = begin; i < end; i++)
+                {
+                    const float *p = position(i);
+                    float cellCenter[3] = { center[0], center[1], center[2] };
+                    float cellSize = size;
+                    uint64_t key = 0;
+                    for (size_t level = 0; level < numLevels; level++)
+                    {
+                        float newSize = cellSize / 2;
+                        for (size_t d = 0; d < 3; d++)
+                        {
+                            bool above = p[d] > cellCenter[d];
+                            key = (key << 1) | above;
+                            cellCenter[d] = above ? cellCenter[d] + newSize : cellCenter[d] - newSize;
+                        }
+                        cellSize = newSize;
+                    }
+                    keys[i] = key;
+                }
+            });
+            std::vector<uint64_t> uniqueKeys(keys);
+            std::sort(uniqueKeys.begin(), uniqueKeys.end());
+            uniqueKeys.erase(std::unique(uniqueKeys.begin(), uniqueKeys.end()), uniqueKeys.end());
+            mNumLeaves = uniqueKeys.size();
+            mLeaves.resize(numPoints);
+            parallelFor(numPoints, maxThreads, [&](size_t begin, size_t end, size_t) {
+                for (size_t i = begin; i < end; i++)
+                {
+                    mLeaves[i] = uint32_t(std::lower_bound(uniqueKeys.begin(), uniqueKeys.end(), keys[i]) - uniqueKeys.begin());
+                }
+            });
+        }
+
+        size_t numLeaves() const
+        {
+            return mNumLeaves;
+        }
+
+        uint32_t leaf(size_t index) const
+        {
+            return mLeaves[index];
+        }
+
+    private:
+        std::vector<uint32_t> mLeaves;
+        size_t mNumLeaves;
+
+    };
+
+    /**
+     * @brief The planes of every point (in the order of the plane list), as offsets into one array of plane indices
+     */
+    struct Labels
+    {
+        std::vector<size_t> offsets;
+        std::vector<uint32_t> planes;
+
+        /**
+         * @param inliers
+         *      inliers(i) gives the inliers of the plane i. Inliers out of the point cloud are ignored.
+         */
+        template <class Inliers>
+        Labels(size_t numPoints, size_t numPlanes, const Inliers &inliers)
+            : offsets(numPoints + 1, 0)
+        {
+            for (size_t i = 0; i < numPlanes; i++)
+            {
+                for (const size_t &inlier : inliers(i))
+                {
+                    if (inlier < numPoints) offsets[inlier + 1]++;
+                }
+            }
+            for (size_t i = 0; i < numPoints; i++)
+            {
+                offsets[i + 1] += offsets[i];
+            }
+            planes.resize(offsets.back());
+            std::vector<size_t> position(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i < numPlanes; i++)
+            {
+                for (const size_t &inlier : inliers(i))
+                {
+                    if (inlier < numPoints) planes[position[inlier]++] = uint32_t(i);
+                }
+            }
+        }
+
+        /**
+         * @brief The plane of every point, -1 (or a label of no plane) for none
+         */
+        Labels(const std::vector<int32_t> &labels, size_t numPlanes)
+            : offsets(labels.size() + 1, 0)
+        {
+            for (size_t i = 0; i < labels.size(); i++)
+            {
+                bool labeled = labels[i] >= 0 && size_t(labels[i]) < numPlanes;
+                offsets[i + 1] = offsets[i] + labeled;
+                if (labeled) planes.push_back(uint32_t(labels[i]));
+            }
+        }
+
+        size_t numPoints() const
+        {
+            return offsets.size() - 1;
+        }
+
+        bool empty(size_t point) const
+        {
+            return offsets[point] == offsets[point + 1];
+        }
+
+        bool contains(size_t point, int64_t plane) const
+        {
+            for (size_t j = offsets[point]; j < offsets[point + 1]; j++)
+            {
+                if (planes[j] == plane) return true;
+            }
+            return false;
+        }
+    };
+
+    struct Score
+    {
+        float precision;
+        float recall;
+        float f1;
+        size_t numCorrect;
+    };
+
+    static bool isPlaneEquivalent(const float *normalA, const float *normalB)
+    {
+        float dot = std::abs(normalA[0] * normalB[0] + normalA[1] * normalB[1] + normalA[2] * normalB[2]);
+        return dot > 0.86; // 30 degrees
+    }
+
+    /**
+     * @brief For every test plane, its ground truth plane or -1. The counts are a sparse contingency table (test
+     * plane, ground truth plane or none), filled concurrently.
+     *
+     * @param groundTruthNormals, testNormals
+     *      3 coordinates per plane
+     * @param testSizes
+     *      Number of inliers of every test plane
+     */
+    static std::vector<int64_t> findCorrespondences(const Labels &groundTruth, const Labels &test, const std::vector<float> &groundTruthNormals,
+                                                    const std::vector<float> &testNormals, const std::vector<size_t> &testSizes, size_t maxThreads)
+    {
+        size_t numPoints = test.numPoints();
+        uint64_t stride = groundTruthNormals.size() / 3 + 1;
+        size_t numThreads = numThreadsFor(numPoints, maxThreads);
+        std::vector<std::unordered_map<uint64_t, size_t> > tables(numThreads);
+        parallelFor(numPoints, maxThreads, [&](size_t begin, size_t end, size_t thread) {
+            std::unordered_map<uint64_t, size_t> &table = tables[thread];
+            for (size_t i = begin; i < end; i++)
+            {
+                if (test.empty(i)) continue;
+                uint64_t first = groundTruth.empty(i) ? 0 : groundTruth.planes[groundTruth.offsets[i]] + 1;
+                for (size_t j = test.offsets[i]; j < test.offsets[i + 1]; j++)
+                {
+                    table[test.planes[j] * stride + first]++;
+                }
+            }
+        });
+        for (size_t t = 1; t < numThreads; t++)
+        {
+            for (auto it = tables[t].begin(); it != tables[t].end(); ++it)
+            {
+                tables[0][it->first] += it->second;
+            }
+        }
+
+        // the cells of each test plane, in ground truth order (none first)
+        std::vector<std::pair<uint64_t, size_t> > cells(tables[0].begin(), tables[0].end());
+        std::sort(cells.begin(), cells.end());
+        std::vector<int64_t> correspondences(testSizes.size(), -1);
+        for (size_t c = 0; c < cells.size();)
+        {
+            size_t testPlane = cells[c].first / stride;
+            uint64_t bestPlane = 0;
+            size_t bestCount = 0;
+            for (; c < cells.size() && cells[c].first / stride == testPlane; c++)
+            {
+                if (cells[c].second > bestCount)
+                {
+                    bestPlane = cells[c].first % stride;
+                    bestCount = cells[c].second;
+                }
+            }
+            if (bestPlane == 0 || bestCount < testSizes[testPlane] / 2 ||
+                    !isPlaneEquivalent(&groundTruthNormals[3 * (bestPlane - 1)], &testNormals[3 * testPlane]))
+                continue;
+            correspondences[testPlane] = int64_t(bestPlane - 1);
+        }
+        return correspondences;
+    }
+
+    /**
+     * @brief Precision and recall, counted in octree leaves: a leaf of a test plane is correct if one of its inliers
+     * there is also on the corresponding ground truth plane, a leaf of a ground truth plane if one of its inliers
+     * there is also on a corresponding test plane. Both are 0 without any leaf.
+     */
+    static void getPrecisionRecall(const Leaves &leaves, const std::vector<int64_t> &correspondences, const Labels &groundTruth,
+                                   const Labels &test, size_t maxThreads, float &precision, float &recall)
+    {
+        size_t numPoints = test.numPoints();
+        size_t numThreads = numThreadsFor(numPoints, maxThreads);
+        // bit 0: test leaf, bit 1: correct test leaf, bit 2: ground truth leaf, bit 3: correct ground truth leaf (a
+        // point of a test plane on its corresponding ground truth plane is correct for both)
+        std::vector<std::vector<uint8_t> > flags(numThreads, std::vector<uint8_t>(leaves.numLeaves(), 0));
+        parallelFor(numPoints, maxThreads, [&](size_t begin, size_t end, size_t thread) {
+            std::vector<uint8_t> &leafFlags = flags[thread];
+            for (size_t i = begin; i < end; i++)
+            {
+                uint8_t flag = 0;
+                for (size_t j = test.offsets[i]; j < test.offsets[i + 1]; j++)
+                {
+                    flag |= 1;
+                    int64_t correspondence = correspondences[test.planes[j]];
+                    if (correspondence >= 0 && groundTruth.contains(i, correspondence))
+                    {
+                        flag |= 2 | 8;
+                    }
+                }
+                if (!groundTruth.empty(i))
+                    flag |= 4;
+                leafFlags[leaves.leaf(i)] |= flag;
+            }
+        });
+        size_t allTestLeaves = 0, correctTestLeaves = 0, allGroundTruthLeaves = 0, correctGroundTruthLeaves = 0;
+        for (size_t leaf = 0; leaf < leaves.numLeaves(); leaf++)
+        {
+            uint8_t flag = 0;
+            for (size_t t = 0; t < numThreads; t++)
+            {
+                flag |= flags[t][leaf];
+            }
+            allTestLeaves += (flag & 1) != 0;
+            correctTestLeaves += (flag & 2) != 0;
+            allGroundTruthLeaves += (flag & 4) != 0;
+            correctGroundTruthLeaves += (flag & 8) != 0;
+        }
+        precision = allTestLeaves > 0 ? correctTestLeaves / float(allTestLeaves) : 0;
+        recall = allGroundTruthLeaves > 0 ? correctGroundTruthLeaves / float(allGroundTruthLeaves) : 0;
+    }
+
+    /**
+     * @brief Scores the test planes: precision, recall, F1 score and number of ground truth planes with a
+     * corresponding test plane
+     */
+    static Score score(const Leaves &leaves, const Labels &groundTruth, const Labels &test, const std::vector<float> &groundTruthNormals,
+                       const std::vector<float> &testNormals, const std::vector<size_t> &testSizes, size_t maxThreads)
+    {
+        std::vector<int64_t> correspondences = findCorrespondences(groundTruth, test, groundTruthNormals, testNormals, testSizes, maxThreads);
+        Score score;
+        getPrecisionRecall(leaves, correspondences, groundTruth, test, maxThreads, score.precision, score.recall);
+        score.f1 = score.precision + score.recall > 0 ? 2 * (score.precision * score.recall) / (score.precision + score.recall) : 0;
+        std::vector<bool> corrects(groundTruthNormals.size() / 3, false);
+        for (const int64_t &correspondence : correspondences)
+        {
+            if (correspondence >= 0) corrects[correspondence] = true;
+        }
+        score.numCorrect = size_t(std::count(corrects.begin(), corrects.end(), true));
+        return score;
+    }
+
+};
+
+#endif // PLANEMETRICS_H
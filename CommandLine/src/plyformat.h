@@ -0,0 +1,257 @@
+#ifndef PLYFORMAT_H
+#define PLYFORMAT_H
+
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Header and binary values of PLY files (ASCII, binary little endian and binary big endian)
+ */
+class PLYFormat
+{
+public:
+    enum Format
+    {
+        ASCII = 0,
+        BINARY_LITTLE_ENDIAN = 1,
+        BINARY_BIG_ENDIAN = 2
+    };
+
+    enum Type
+    {
+        INT8 = 0,
+        UINT8 = 1,
+        INT16 = 2,
+        UINT16 = 3,
+        INT32 = 4,
+        UINT32 = 5,
+        FLOAT32 = 6,
+        FLOAT64 = 7
+    };
+
+    struct Property
+    {
+        std::string name;
+        Type type;
+        bool isList;
+        Type countType;
+        size_t offset;
+    };
+
+    struct Element
+    {
+        std::string name;
+        size_t count;
+        std::vector<Property> properties;
+        size_t stride;
+
+        /**
+         * @brief Index of the first property with one of the given names (-1 if there is none)
+         */
+        int property(std::initializer_list<const char*> names) const
+        {
+            for (const char *name : names)
+            {
+                for (size_t i = 0; i < properties.size(); i++)
+                {
+                    if (properties[i].name == name) return int(i);
+                }
+            }
+            return -1;
+        }
+
+        bool hasLists() const
+        {
+            for (const Property &property : properties)
+            {
+                if (property.isList) return true;
+            }
+            return false;
+        }
+    };
+
+    struct Header
+    {
+        Format format;
+        std::vector<Element> elements;
+        size_t size;
+    };
+
+    static Header parseHeader(const char *data, size_t size)
+    {
+        Header header;
+        header.format = ASCII;
+        header.size = 0;
+        bool hasFormat = false;
+        const char *p = data;
+        const char *end = data + size;
+        for (size_t lineNumber = 0; ; lineNumber++)
+        {
+            const char *lineEnd = static_cast<const char*>(memchr(p, '\n', end - p));
+            if (lineEnd == NULL)
+                throw std::string("Invalid PLY header");
+            std::istringstream line(std::string(p, lineEnd));
+            p = lineEnd + 1;
+            std::string keyword;
+            line >> keyword;
+            if (lineNumber == 0)
+            {
+                if (keyword != "ply")
+                    throw std::string("Not a PLY file");
+            }
+            else if (keyword == "format")
+            {
+                std::string format;
+                line >> format;
+                if (format == "ascii") header.format = ASCII;
+                else if (format == "binary_little_endian") header.format = BINARY_LITTLE_ENDIAN;
+                else if (format == "binary_big_endian") header.format = BINARY_BIG_ENDIAN;
+                else throw "Unknown PLY format: " + format;
+                hasFormat = true;
+            }
+            else if (keyword == "element")
+            {
+                Element element;
+                line >> element.name >> element.count;
+                element.stride = 0;
+                header.elements.push_back(element);
+            }
+            else if (keyword == "property")
+            {
+                if (header.elements.empty())
+                    throw std::string("PLY property without element");
+                Element &element = header.elements.back();
+                Property property;
+                std::string type;
+                line >> type;
+                property.isList = type == "list";
+                if (property.isList)
+                {
+                    std::string countType;
+                    line >> countType >> type;
+                    property.countType = parseType(countType);
+                }
+                else
+                {
+                    property.countType = UINT8;
+                }
+                property.type = parseType(type);
+                line >> property.name;
+                property.offset = element.stride;
+                element.stride += property.isList ? 0 : typeSize(property.type);
+                element.properties.push_back(property);
+            }
+            else if (keyword == "end_header")
+            {
+                break;
+            }
+        }
+        if (!hasFormat)
+            throw std::string("PLY format not specified");
+        for (Element &element : header.elements)
+        {
+            // elements with lists have no fixed size
+            if (element.hasLists()) element.stride = 0;
+        }
+        header.size = p - data;
+        return header;
+    }
+
+    static Type parseType(const std::string &name)
+    {
+        if (name == "char" || name == "int8") return INT8;
+        if (name == "uchar" || name == "uint8") return UINT8;
+        if (name == "short" || name == "int16") return INT16;
+        if (name == "ushort" || name == "uint16") return UINT16;
+        if (name == "int" || name == "int32") return INT32;
+        if (name == "uint" || name == "uint32") return UINT32;
+        if (name == "float" || name == "float32") return FLOAT32;
+        if (name == "double" || name == "float64") return FLOAT64;
+        throw "Unknown PLY type: " + name;
+    }
+
+    static const char* typeName(Type type)
+    {
+        static const char *names[] = { "char", "uchar", "short", "ushort", "int", "uint", "float", "double" };
+        return names[type];
+    }
+
+    static size_t typeSize(Type type)
+    {
+        static const size_t sizes[] = { 1, 1, 2, 2, 4, 4, 4, 8 };
+        return sizes[type];
+    }
+
+    static bool isLittleEndian()
+    {
+        const uint16_t value = 1;
+        return *reinterpret_cast<const uint8_t*>(&value) == 1;
+    }
+
+    /**
+     * @brief Reads a binary value, swapping its bytes if the file and the machine differ in endianness
+     */
+    inline static double read(const char *p, Type type, bool swap)
+    {
+        char bytes[8];
+        size_t size = typeSize(type);
+        if (swap)
+        {
+            for (size_t i = 0; i < size; i++)
+            {
+                bytes[i] = p[size - 1 - i];
+            }
+            p = bytes;
+        }
+        switch (type)
+        {
+        case INT8: return *reinterpret_cast<const int8_t*>(p);
+        case UINT8: return *reinterpret_cast<const uint8_t*>(p);
+        case INT16: return load<int16_t>(p);
+        case UINT16: return load<uint16_t>(p);
+        case INT32: return load<int32_t>(p);
+        case UINT32: return load<uint32_t>(p);
+        case FLOAT32: return load<float>(p);
+        case FLOAT64: return load<double>(p);
+        }
+        return 0;
+    }
+
+    /**
+     * @brief Moves p past one binary instance of an element with lists
+     */
+    static const char* skip(const char *p, const char *end, const Element &element, bool swap)
+    {
+        for (const Property &property : element.properties)
+        {
+            size_t size = typeSize(property.type);
+            if (property.isList)
+            {
+                if (p + typeSize(property.countType) > end)
+                    throw std::string("Truncated PLY file");
+                size_t count = size_t(read(p, property.countType, swap));
+                size = typeSize(property.countType) + count * size;
+            }
+            if (p + size > end)
+                throw std::string("Truncated PLY file");
+            p += size;
+        }
+        return p;
+    }
+
+private:
+    template <class T>
+    inline static T load(const char *p)
+    {
+        T value;
+        memcpy(&value, p, sizeof(T));
+        return value;
+    }
+
+};
+
+#endif // PLYFORMAT_H
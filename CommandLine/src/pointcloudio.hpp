@@ -2,23 +2,52 @@
 #define POINTCLOUDLOADER_H
 
 #include <stdio.h>
-#include <locale.h>
 
 #include <fstream>
-#include <sstream>
 #include <iostream>
+#include <limits>
 
 #include "pointcloud.h"
+#include "trace.h"
+#include "mappedpointcloud.h"
+#include "asciiparser.h"
+#include "plyformat.h"
+#include "lasformat.h"
+#include "parallel.h"
+#include "inliercodec.h"
 
 class PointCloudIO 
 {
 public:
+    PointCloudIO()
+        : mOrigin(Eigen::Vector3d::Zero())
+    {
+
+    }
+
     void saveGeometry(const Geometry *geometry, const std::string &filename)
     {
+        TraceScope trace("PointCloudIO::saveGeometry");
         FILE *fp = fopen(filename.c_str(), "wb");
         if (fp == NULL)
             throw "Could not open file: " + filename;
 
+        saveGeometry(geometry, fp);
+        fclose(fp);
+    }
+
+    /**
+     * @brief Writes the geometry at the current position of an open file (e.g. in a '.pcb' file)
+     */
+    void saveGeometry(const Geometry *geometry, FILE *fp)
+    {
+        GeometryHeader header;
+        memcpy(header.magic, "GEOINL", sizeof(header.magic));
+        header.version = GEOMETRY_VERSION;
+        fwrite(&header, sizeof(header), 1, fp);
+        // version 3: the origin the coordinates are relative to
+        fwrite(geometry->origin().data(), sizeof(double), 3, fp);
+
         size_t numCircles = geometry->numCircles();
         fwrite(&numCircles, sizeof(size_t), 1, fp);
         for (size_t i = 0; i < numCircles; i++)
@@ -31,9 +60,7 @@ public:
             fwrite(center.data(), sizeof(float), 2, fp);
             fwrite(&radius, sizeof(float), 1, fp);
             const std::vector<size_t> &inliers = circle->inliers();
-            size_t numInliers = inliers.size();
-            fwrite(&numInliers, sizeof(size_t), 1, fp);
-            fwrite(inliers.data(), sizeof(size_t), numInliers, fp);
+            writeInliers(inliers, fp);
         }
 
         size_t numPlanes = geometry->numPlanes();
@@ -52,9 +79,7 @@ public:
             fwrite(basisU.data(), sizeof(float), 3, fp);
             fwrite(basisV.data(), sizeof(float), 3, fp);
             const std::vector<size_t> &inliers = plane->inliers();
-            size_t numInliers = inliers.size();
-            fwrite(&numInliers, sizeof(size_t), 1, fp);
-            fwrite(inliers.data(), sizeof(size_t), numInliers, fp);
+            writeInliers(inliers, fp);
         }
 
         size_t numCylinders = geometry->numCylinders();
@@ -73,42 +98,152 @@ public:
             fwrite(&radius, sizeof(float), 1, fp);
             fwrite(&height, sizeof(float), 1, fp);
             const std::vector<size_t> &inliers = cylinder->inliers();
-            size_t numInliers = inliers.size();
-            fwrite(&numInliers, sizeof(size_t), 1, fp);
-            fwrite(inliers.data(), sizeof(size_t), numInliers, fp);
+            writeInliers(inliers, fp);
         }
-        fclose(fp);
     }
 
-    void saveConnectivity(const ConnectivityGraph *connectivity, const std::string &filename)
+    /**
+     * @brief Saves the connectivity in the CSR '.con' format: a header, then numPoints + 1 offsets, the neighbors
+     * of all the points, their distances (only if pointCloud is given) and the group of each point, each as a
+     * single block
+     */
+    void saveConnectivity(const ConnectivityGraph *connectivity, const std::string &filename, const PointCloud3d *pointCloud = NULL)
     {
+        TraceScope trace("PointCloudIO::saveConnectivity");
         FILE *fp = fopen(filename.c_str(), "wb");
         if (fp == NULL)
             throw "Could not open file: " + filename;
 
         size_t size = connectivity->numPoints();
+        std::vector<size_t> offsets(size + 1, 0);
+        for (size_t i = 0; i < size; i++)
+        {
+            std::pair<std::vector<size_t>::const_iterator, std::vector<size_t>::const_iterator> neighbors = connectivity->neighborsIterator(i);
+            offsets[i + 1] = offsets[i] + (neighbors.second - neighbors.first);
+        }
+        ConnectivityHeader header;
+        memcpy(header.magic, "CONCSR", sizeof(header.magic));
+        header.version = CONNECTIVITY_VERSION;
+        header.flags = CONNECTIVITY_GROUPS | (pointCloud != NULL ? CONNECTIVITY_DISTANCES : 0);
+        header.reserved = 0;
+        header.numPoints = size;
+        header.numEdges = offsets.back();
+        fwrite(&header, sizeof(header), 1, fp);
+        fwrite(offsets.data(), sizeof(size_t), offsets.size(), fp);
+
+        // the neighbors are not necessarily stored in point order in the graph, they are written through a buffer
+        const size_t bufferSize = 1 << 20;
+        std::vector<size_t> neighbors;
         for (size_t i = 0; i < size; i++)
         {
-            size_t numNeighbors = connectivity->neighbors(i).size();
-            fwrite(&numNeighbors, sizeof(size_t), 1, fp);
-            std::vector<size_t> edges;
+            std::pair<std::vector<size_t>::const_iterator, std::vector<size_t>::const_iterator> iterator = connectivity->neighborsIterator(i);
+            neighbors.insert(neighbors.end(), iterator.first, iterator.second);
+            if (neighbors.size() >= bufferSize || i + 1 == size)
+            {
+                fwrite(neighbors.data(), sizeof(size_t), neighbors.size(), fp);
+                neighbors.clear();
+            }
+        }
+        if (pointCloud != NULL)
+        {
             std::vector<float> distances;
-            for (const size_t &p : connectivity->neighbors(i))
+            for (size_t i = 0; i < size; i++)
             {
-                edges.push_back(p);
-                distances.push_back(0);
+                std::pair<std::vector<size_t>::const_iterator, std::vector<size_t>::const_iterator> iterator = connectivity->neighborsIterator(i);
+                for (std::vector<size_t>::const_iterator it = iterator.first; it != iterator.second; ++it)
+                {
+                    distances.push_back((pointCloud->at(i).position() - pointCloud->at(*it).position()).norm());
+                }
+                if (distances.size() >= bufferSize || i + 1 == size)
+                {
+                    fwrite(distances.data(), sizeof(float), distances.size(), fp);
+                    distances.clear();
+                }
             }
-            fwrite(edges.data(), sizeof(size_t), numNeighbors, fp);
-            fwrite(distances.data(), sizeof(float), numNeighbors, fp);
         }
         fwrite(connectivity->groupIndices().data(), sizeof(size_t), size, fp);
 
+        if (fclose(fp) != 0)
+            throw "Could not write file: " + filename;
+    }
+
+    void saveIndices(const std::vector<size_t> &indices, const std::string &filename)
+    {
+        TraceScope trace("PointCloudIO::saveIndices");
+        FILE *fp = fopen(filename.c_str(), "wb");
+        if (fp == NULL)
+            throw "Could not open file: " + filename;
+
+        size_t size = indices.size();
+        fwrite(&size, sizeof(size_t), 1, fp);
+        fwrite(indices.data(), sizeof(size_t), size, fp);
+
         fclose(fp);
     }
 
+    /**
+     * @brief Saves a '.lbl' file: the plane of every point (its index in the plane table, or -1) as an int32, with
+     * no header, so the file can be memory mapped as an array of labels
+     */
+    void saveLabels(const std::vector<int32_t> &labels, const std::string &filename)
+    {
+        TraceScope trace("PointCloudIO::saveLabels");
+        FILE *fp = fopen(filename.c_str(), "wb");
+        if (fp == NULL)
+            throw "Could not open file: " + filename;
+
+        fwrite(labels.data(), sizeof(int32_t), labels.size(), fp);
+
+        if (fclose(fp) != 0)
+            throw "Could not write file: " + filename;
+    }
+
+    /**
+     * @brief Saves a '.pln' plane table: a header, then a fixed size record per plane (normal, center, basis
+     * vectors, color and number of points) in label order. The numbers of points are counted from labels. The
+     * header holds the origin the centers are relative to (see Geometry::origin).
+     */
+    void savePlaneTable(const std::vector<Plane*> &planes, const std::vector<int32_t> &labels, const std::string &filename,
+                        const Eigen::Vector3d &origin = Eigen::Vector3d::Zero())
+    {
+        TraceScope trace("PointCloudIO::savePlaneTable");
+        FILE *fp = fopen(filename.c_str(), "wb");
+        if (fp == NULL)
+            throw "Could not open file: " + filename;
+
+        std::vector<uint64_t> numPoints(planes.size(), 0);
+        for (const int32_t &label : labels)
+        {
+            if (label >= 0 && size_t(label) < planes.size()) numPoints[label]++;
+        }
+        PlaneTableHeader header;
+        memcpy(header.magic, "PLNTBL", sizeof(header.magic));
+        header.version = PLANE_TABLE_VERSION;
+        header.numPlanes = planes.size();
+        header.numPoints = labels.size();
+        Eigen::Map<Eigen::Vector3d>(header.origin) = origin;
+        fwrite(&header, sizeof(header), 1, fp);
+        for (size_t i = 0; i < planes.size(); i++)
+        {
+            PlaneRecord record;
+            Eigen::Map<Eigen::Vector3f>(record.normal) = planes[i]->normal();
+            Eigen::Map<Eigen::Vector3f>(record.center) = planes[i]->center();
+            Eigen::Map<Eigen::Vector3f>(record.basisU) = planes[i]->basisU();
+            Eigen::Map<Eigen::Vector3f>(record.basisV) = planes[i]->basisV();
+            Eigen::Map<Eigen::Vector3f>(record.color) = planes[i]->color();
+            record.reserved = 0;
+            record.numPoints = numPoints[i];
+            fwrite(&record, sizeof(record), 1, fp);
+        }
+
+        if (fclose(fp) != 0)
+            throw "Could not write file: " + filename;
+    }
+
     template <size_t DIMENSION>
     void saveAsPCL(const PointCloud<DIMENSION> *pointCloud, const std::string &filename)
     {
+        TraceScope trace("PointCloudIO::saveAsPCL");
         FILE *fp = fopen(filename.c_str(), "wb");
         if (fp == NULL)
             throw "Could not open file: " + filename;
@@ -151,6 +286,7 @@ public:
 
     void saveAsPoints(const PointCloud3d *pointCloud, const std::string &filename)
     {
+        TraceScope trace("PointCloudIO::saveAsPoints");
         FILE *fp = fopen(filename.c_str(), "wb");
         if (fp == NULL)
             throw "Could not open file: " + filename;
@@ -173,6 +309,7 @@ public:
 
     void saveAsXYZ(const PointCloud3d *pointCloud, const std::string &filename)
     {
+        TraceScope trace("PointCloudIO::saveAsXYZ");
         FILE *fp = fopen(filename.c_str(), "wb");
         if (fp == NULL)
             throw "Could not open file: " + filename;
@@ -194,6 +331,7 @@ public:
 
     void saveAsPTX(const PointCloud3d *pointCloud, const std::string &filename)
     {
+        TraceScope trace("PointCloudIO::saveAsPTX");
         FILE *fp = fopen(filename.c_str(), "wb");
         if (fp == NULL)
             throw "Could not open file: " + filename;
@@ -221,6 +359,211 @@ public:
         fclose(fp);
     }
 
+    void saveAsPCB(const PointCloud3d *pointCloud, const std::string &filename)
+    {
+        TraceScope trace("PointCloudIO::saveAsPCB");
+        FILE *fp = fopen(filename.c_str(), "wb");
+        if (fp == NULL)
+            throw "Could not open file: " + filename;
+
+        const MappedPointCloud::Section attributes[] = { MappedPointCloud::POSITIONS, MappedPointCloud::COLORS, MappedPointCloud::INTENSITIES,
+                                                         MappedPointCloud::NORMALS, MappedPointCloud::NORMAL_CONFIDENCES, MappedPointCloud::CURVATURES };
+        const size_t modes[] = { 0, PointCloud3d::COLOR, PointCloud3d::INTENSITY, PointCloud3d::NORMAL, PointCloud3d::NORMAL_CONFIDENCE, PointCloud3d::CURVATURE };
+        std::vector<MappedPointCloud::SectionEntry> sections;
+        for (size_t i = 0; i < 6; i++)
+        {
+            if (modes[i] == 0 || pointCloud->hasMode(modes[i]))
+                sections.push_back({ uint32_t(attributes[i]), 0, 0, 0 });
+        }
+        const ConnectivityGraph *connectivity = pointCloud->connectivity();
+        if (connectivity != NULL)
+        {
+            sections.push_back({ uint32_t(MappedPointCloud::CONNECTIVITY_OFFSETS), 0, 0, 0 });
+            sections.push_back({ uint32_t(MappedPointCloud::CONNECTIVITY_NEIGHBORS), 0, 0, 0 });
+            if (connectivity->hasGroups())
+                sections.push_back({ uint32_t(MappedPointCloud::CONNECTIVITY_GROUPS), 0, 0, 0 });
+        }
+        sections.push_back({ uint32_t(MappedPointCloud::GEOMETRY), 0, 0, 0 });
+
+        size_t size = pointCloud->size();
+        MappedPointCloud::Header header;
+        memcpy(header.magic, "PCB", 4);
+        header.version = MappedPointCloud::VERSION;
+        header.numPoints = size;
+        header.mode = pointCloud->mode();
+        header.numSections = uint32_t(sections.size());
+        header.reserved = 0;
+        fwrite(&header, sizeof(header), 1, fp);
+        // the offsets and sizes are only known once the sections are written, the table is written again then
+        fwrite(sections.data(), sizeof(MappedPointCloud::SectionEntry), sections.size(), fp);
+
+        const size_t chunkSize = 1 << 16;
+        std::vector<float> floats;
+        std::vector<uint64_t> integers;
+        for (MappedPointCloud::SectionEntry &section : sections)
+        {
+            uint64_t position = filePosition(fp);
+            static const char padding[MappedPointCloud::ALIGNMENT] = { 0 };
+            fwrite(padding, 1, (MappedPointCloud::ALIGNMENT - position % MappedPointCloud::ALIGNMENT) % MappedPointCloud::ALIGNMENT, fp);
+            section.offset = filePosition(fp);
+            switch (section.type)
+            {
+            case MappedPointCloud::CONNECTIVITY_OFFSETS:
+            case MappedPointCloud::CONNECTIVITY_NEIGHBORS:
+            case MappedPointCloud::CONNECTIVITY_GROUPS:
+            {
+                uint64_t offset = 0;
+                if (section.type == MappedPointCloud::CONNECTIVITY_OFFSETS)
+                    fwrite(&offset, sizeof(uint64_t), 1, fp);
+                for (size_t begin = 0; begin < size; begin += chunkSize)
+                {
+                    integers.clear();
+                    for (size_t i = begin; i < std::min(size, begin + chunkSize); i++)
+                    {
+                        if (section.type == MappedPointCloud::CONNECTIVITY_GROUPS)
+                        {
+                            integers.push_back(connectivity->groupOf(i));
+                            continue;
+                        }
+                        std::pair<std::vector<size_t>::const_iterator, std::vector<size_t>::const_iterator> neighbors = connectivity->neighborsIterator(i);
+                        if (section.type == MappedPointCloud::CONNECTIVITY_OFFSETS)
+                        {
+                            offset += neighbors.second - neighbors.first;
+                            integers.push_back(offset);
+                        }
+                        else
+                        {
+                            integers.insert(integers.end(), neighbors.first, neighbors.second);
+                        }
+                    }
+                    fwrite(integers.data(), sizeof(uint64_t), integers.size(), fp);
+                }
+                break;
+            }
+            case MappedPointCloud::GEOMETRY:
+                saveGeometry(pointCloud->geometry(), fp);
+                break;
+            default:
+                for (size_t begin = 0; begin < size; begin += chunkSize)
+                {
+                    floats.clear();
+                    for (size_t i = begin; i < std::min(size, begin + chunkSize); i++)
+                    {
+                        const Point3d &point = pointCloud->at(i);
+                        switch (section.type)
+                        {
+                        case MappedPointCloud::POSITIONS:
+                            floats.insert(floats.end(), point.position().data(), point.position().data() + 3);
+                            break;
+                        case MappedPointCloud::COLORS:
+                            floats.insert(floats.end(), point.color().data(), point.color().data() + 3);
+                            break;
+                        case MappedPointCloud::INTENSITIES:
+                            floats.push_back(point.intensity());
+                            break;
+                        case MappedPointCloud::NORMALS:
+                            floats.insert(floats.end(), point.normal().data(), point.normal().data() + 3);
+                            break;
+                        case MappedPointCloud::NORMAL_CONFIDENCES:
+                            floats.push_back(point.normalConfidence());
+                            break;
+                        case MappedPointCloud::CURVATURES:
+                            floats.push_back(point.curvature());
+                            break;
+                        }
+                    }
+                    fwrite(floats.data(), sizeof(float), floats.size(), fp);
+                }
+            }
+            section.size = filePosition(fp) - section.offset;
+        }
+
+        fseek(fp, sizeof(header), SEEK_SET);
+        fwrite(sections.data(), sizeof(MappedPointCloud::SectionEntry), sections.size(), fp);
+        if (fclose(fp) != 0)
+            throw "Could not write file: " + filename;
+    }
+
+    /**
+     * @brief Saves a '.ply' file, binary (in the byte order of this machine) or ASCII. With planeLabels, every
+     * vertex also gets an int property 'plane': the index of its plane in the geometry of the point cloud, or -1.
+     */
+    void saveAsPLY(const PointCloud3d *pointCloud, const std::string &filename, bool planeLabels = false, bool binary = true)
+    {
+        TraceScope trace("PointCloudIO::saveAsPLY");
+        FILE *fp = fopen(filename.c_str(), "wb");
+        if (fp == NULL)
+            throw "Could not open file: " + filename;
+
+        size_t size = pointCloud->size();
+        std::vector<int32_t> labels;
+        if (planeLabels)
+        {
+            labels.assign(size, -1);
+            const Geometry *geometry = pointCloud->geometry();
+            for (size_t i = 0; i < geometry->numPlanes(); i++)
+            {
+                for (const size_t &inlier : geometry->plane(i)->inliers())
+                {
+                    labels[inlier] = int32_t(i);
+                }
+            }
+        }
+        bool hasNormal = pointCloud->hasMode(PointCloud3d::NORMAL);
+        bool hasColor = pointCloud->hasMode(PointCloud3d::COLOR);
+        bool hasIntensity = pointCloud->hasMode(PointCloud3d::INTENSITY);
+        bool hasConfidence = pointCloud->hasMode(PointCloud3d::NORMAL_CONFIDENCE);
+        bool hasCurvature = pointCloud->hasMode(PointCloud3d::CURVATURE);
+
+        fprintf(fp, "ply\nformat %s 1.0\nelement vertex %zu\n", !binary ? "ascii" : PLYFormat::isLittleEndian() ? "binary_little_endian" : "binary_big_endian", size);
+        fprintf(fp, "property float x\nproperty float y\nproperty float z\n");
+        if (hasNormal) fprintf(fp, "property float nx\nproperty float ny\nproperty float nz\n");
+        if (hasColor) fprintf(fp, "property uchar red\nproperty uchar green\nproperty uchar blue\n");
+        if (hasIntensity) fprintf(fp, "property float intensity\n");
+        if (hasConfidence) fprintf(fp, "property float confidence\n");
+        if (hasCurvature) fprintf(fp, "property float curvature\n");
+        if (planeLabels) fprintf(fp, "property int plane\n");
+        fprintf(fp, "end_header\n");
+
+        std::vector<char> buffer;
+        for (size_t i = 0; i < size; i++)
+        {
+            const Point3d &point = pointCloud->at(i);
+            float values[] = { point.position().x(), point.position().y(), point.position().z(),
+                               point.normal().x(), point.normal().y(), point.normal().z(),
+                               point.intensity(), point.normalConfidence(), point.curvature() };
+            uint8_t color[] = { uint8_t(255 * point.color().x()), uint8_t(255 * point.color().y()), uint8_t(255 * point.color().z()) };
+            if (!binary)
+            {
+                fprintf(fp, "%.9g %.9g %.9g", values[0], values[1], values[2]);
+                if (hasNormal) fprintf(fp, " %.9g %.9g %.9g", values[3], values[4], values[5]);
+                if (hasColor) fprintf(fp, " %d %d %d", color[0], color[1], color[2]);
+                if (hasIntensity) fprintf(fp, " %.9g", values[6]);
+                if (hasConfidence) fprintf(fp, " %.9g", values[7]);
+                if (hasCurvature) fprintf(fp, " %.9g", values[8]);
+                if (planeLabels) fprintf(fp, " %d", labels[i]);
+                fprintf(fp, "\n");
+                continue;
+            }
+            buffer.insert(buffer.end(), reinterpret_cast<const char*>(values), reinterpret_cast<const char*>(values + 3));
+            if (hasNormal) buffer.insert(buffer.end(), reinterpret_cast<const char*>(values + 3), reinterpret_cast<const char*>(values + 6));
+            if (hasColor) buffer.insert(buffer.end(), color, color + 3);
+            if (hasIntensity) buffer.insert(buffer.end(), reinterpret_cast<const char*>(values + 6), reinterpret_cast<const char*>(values + 7));
+            if (hasConfidence) buffer.insert(buffer.end(), reinterpret_cast<const char*>(values + 7), reinterpret_cast<const char*>(values + 8));
+            if (hasCurvature) buffer.insert(buffer.end(), reinterpret_cast<const char*>(values + 8), reinterpret_cast<const char*>(values + 9));
+            if (planeLabels) buffer.insert(buffer.end(), reinterpret_cast<const char*>(&labels[i]), reinterpret_cast<const char*>(&labels[i] + 1));
+            if (buffer.size() >= (1 << 20))
+            {
+                fwrite(buffer.data(), 1, buffer.size(), fp);
+                buffer.clear();
+            }
+        }
+        fwrite(buffer.data(), 1, buffer.size(), fp);
+
+        if (fclose(fp) != 0)
+            throw "Could not write file: " + filename;
+    }
+
     void save(const PointCloud3d *pointCloud, const std::string &filename)
     {
         std::string extension = filename.substr(filename.find_last_of('.') + 1);
@@ -240,135 +583,157 @@ public:
         {
             PointCloudIO::saveAsPTX(pointCloud, filename);
         }
+        else if (extension == "pcb")
+        {
+            PointCloudIO::saveAsPCB(pointCloud, filename);
+        }
+        else if (extension == "ply")
+        {
+            PointCloudIO::saveAsPLY(pointCloud, filename, pointCloud->geometry()->numPlanes() > 0);
+        }
         else
         {
             throw "Extension not supported: " + extension;
         }
     }
 
-    Geometry* loadGeometry(const std::string &filename)
+    /**
+     * @brief Loads a '.geo' file. The counts read from the file are checked against its size before anything is
+     * allocated, and with numPoints (the size of the point cloud the inliers belong to, if known) the inliers
+     * are checked to be points of it. Returns NULL if the file cannot be opened, throws if it is truncated or
+     * corrupted.
+     */
+    Geometry* loadGeometry(const std::string &filename, size_t numPoints = std::numeric_limits<size_t>::max())
     {
+        TraceScope trace("PointCloudIO::loadGeometry");
         FILE *fp = fopen(filename.c_str(), "rb");
         if (fp == NULL) return NULL;
 
-        Geometry *geometry = new Geometry;
-
-        size_t numCircles;
-        fread(&numCircles, sizeof(size_t), 1, fp);
-        for (size_t i = 0; i < numCircles; i++)
+        Geometry *geometry;
+        try
         {
-            float color[3];
-            float center[2];
-            float radius;
-            fread(color, sizeof(float), 3, fp);
-            fread(center, sizeof(float), 2, fp);
-            fread(&radius, sizeof(float), 1, fp);
-            Circle *circle = new Circle(Eigen::Vector2f(center), radius);
-            circle->color(Eigen::Vector3f(color));
-            size_t numInliers;
-            fread(&numInliers, sizeof(size_t), 1, fp);
-            std::vector<size_t> inliers(numInliers);
-            fread(inliers.data(), sizeof(size_t), numInliers, fp);
-            circle->inliers(inliers);
-            geometry->addCircle(circle);
+            geometry = loadGeometry(fp, numPoints);
         }
-
-        size_t numPlanes;
-        fread(&numPlanes, sizeof(size_t), 1, fp);
-        std::cout << "Planes=" << numPlanes << std::endl;
-        for (size_t i = 0; i < numPlanes; i++)
+        catch (...)
         {
-            float color[3];
-            float center[3];
-            float normal[3];
-            float basisU[3];
-            float basisV[3];
-            fread(color, sizeof(float), 3, fp);
-            fread(center, sizeof(float), 3, fp);
-            fread(normal, sizeof(float), 3, fp);
-            fread(basisU, sizeof(float), 3, fp);
-            fread(basisV, sizeof(float), 3, fp);
-            Plane *plane = new Plane(Eigen::Vector3f(center), Eigen::Vector3f(normal),
-                                     Eigen::Vector3f(basisU), Eigen::Vector3f(basisV));
-            plane->color(Eigen::Vector3f(color));
-            size_t numInliers;
-            fread(&numInliers, sizeof(size_t), 1, fp);
-            std::cout << Eigen::Vector3f(center).transpose() << " " << Eigen::Vector3f(normal).transpose() << " " << numInliers << std::endl;
-            std::vector<size_t> inliers(numInliers);
-            fread(inliers.data(), sizeof(size_t), numInliers, fp);
-            plane->inliers(inliers);
-            geometry->addPlane(plane);
+            fclose(fp);
+            throw;
         }
+        fclose(fp);
+        return geometry;
+    }
 
-        size_t numCylinders;
-        fread(&numCylinders, sizeof(size_t), 1, fp);
-        std::cout << "Cylinders=" << numCylinders << std::endl;
-        for (size_t i = 0; i < numCylinders; i++)
+    /**
+     * @brief Reads a geometry from the current position of an open file (e.g. in a '.pcb' file), see
+     * loadGeometry(const std::string&, size_t)
+     */
+    Geometry* loadGeometry(FILE *fp, size_t numPoints = std::numeric_limits<size_t>::max())
+    {
+        Geometry *geometry = new Geometry;
+        try
         {
-            float color[3];
-            float center[3];
-            float axis[3];
-            float radius;
-            float height;
-            fread(color, sizeof(float), 3, fp);
-            fread(center, sizeof(float), 3, fp);
-            fread(axis, sizeof(float), 3, fp);
-            fread(&radius, sizeof(float), 1, fp);
-            fread(&height, sizeof(float), 1, fp);
-            std::cout << "[" << center[0] << " " << center[1] << " " << center[2] << "] [" << axis[0] << " " << axis[1] << " " << axis[2] << "]" << std::endl;
-            Cylinder *cylinder = new Cylinder(Eigen::Vector3f(center), Eigen::Vector3f(axis),
-                                              radius, height);
-            cylinder->color(Eigen::Vector3f(color));
-            size_t numInliers;
-            fread(&numInliers, sizeof(size_t), 1, fp);
-            std::vector<size_t> inliers(numInliers);
-            fread(inliers.data(), sizeof(size_t), numInliers, fp);
-            cylinder->inliers(inliers);
-            geometry->addCylinder(cylinder);
+            readGeometry(fp, numPoints, geometry);
+        }
+        catch (...)
+        {
+            delete geometry;
+            throw;
         }
-        fclose(fp);
-
         return geometry;
     }
 
+    /**
+     * @brief Loads a '.con' file, in the CSR format (each block is read at once) or in the legacy format
+     * (for each point, the number of neighbors, the neighbors and their distances, then the groups)
+     */
     ConnectivityGraph* loadConnectivity(size_t size, const std::string &filename)
     {
+        TraceScope trace("PointCloudIO::loadConnectivity");
         FILE *fp = fopen(filename.c_str(), "rb");
         if (fp == NULL) return NULL;
 
-        ConnectivityGraph *connectivity = new ConnectivityGraph(size);
-
-        for (size_t i = 0; i < size; i++)
+        std::vector<size_t> offsets(size + 1, 0);
+        std::vector<size_t> neighbors;
+        std::vector<size_t> groupIndices(size, 0);
+        bool hasGroups = true;
+        bool complete = true;
+        ConnectivityHeader header;
+        if (fread(&header, sizeof(header), 1, fp) == 1 && memcmp(header.magic, "CONCSR", sizeof(header.magic)) == 0)
+        {
+            if (header.version > CONNECTIVITY_VERSION || header.numPoints != size)
+            {
+                fclose(fp);
+                throw "Incompatible connectivity file: " + filename;
+            }
+            complete = fread(offsets.data(), sizeof(size_t), size + 1, fp) == size + 1 && offsets.back() == header.numEdges;
+            if (complete)
+            {
+                neighbors.resize(header.numEdges);
+                complete = fread(neighbors.data(), sizeof(size_t), neighbors.size(), fp) == neighbors.size();
+            }
+            if (complete && (header.flags & CONNECTIVITY_DISTANCES))
+            {
+                complete = skipBytes(fp, header.numEdges * sizeof(float));
+            }
+            hasGroups = (header.flags & CONNECTIVITY_GROUPS) != 0;
+            if (complete && hasGroups)
+            {
+                complete = fread(groupIndices.data(), sizeof(size_t), size, fp) == size;
+            }
+        }
+        else
         {
-            size_t numEdges;
-            fread(&numEdges, sizeof(size_t), 1, fp);
-            size_t *edges = new size_t[numEdges];
-            fread(edges, sizeof(size_t), numEdges, fp);
-            float *distances = new float[numEdges];
-            fread(distances, sizeof(float), numEdges, fp);
-            std::vector<size_t> vEdges(numEdges);
-            for (size_t i = 0; i < numEdges; i++)
+            rewind(fp);
+            std::vector<float> distances;
+            for (size_t i = 0; i < size && complete; i++)
             {
-                vEdges[i] = edges[i];
+                size_t numEdges;
+                complete = fread(&numEdges, sizeof(size_t), 1, fp) == 1 && numEdges <= size;
+                if (!complete) break;
+                offsets[i + 1] = offsets[i] + numEdges;
+                neighbors.resize(offsets[i + 1]);
+                distances.resize(numEdges);
+                complete = fread(neighbors.data() + offsets[i], sizeof(size_t), numEdges, fp) == numEdges &&
+                           fread(distances.data(), sizeof(float), numEdges, fp) == numEdges;
             }
-            connectivity->addNode(i, vEdges);
-            delete[] edges;
-            delete[] distances;
+            complete = complete && fread(groupIndices.data(), sizeof(size_t), size, fp) == size;
         }
+        fclose(fp);
+        if (!complete)
+            throw "Truncated connectivity file: " + filename;
 
-        std::vector<size_t> groupIndices(size);
-        fread(groupIndices.data(), sizeof(size_t), size, fp);
-        connectivity->setGroupIndices(groupIndices);
+        ConnectivityGraph *connectivity = new ConnectivityGraph(size);
+        connectivity->setEdges(offsets, std::move(neighbors));
+        if (hasGroups) connectivity->setGroupIndices(groupIndices);
+        return connectivity;
+    }
+
+    std::vector<size_t> loadIndices(const std::string &filename)
+    {
+        TraceScope trace("PointCloudIO::loadIndices");
+        FILE *fp = fopen(filename.c_str(), "rb");
+        if (fp == NULL)
+            throw "Could not open file: " + filename;
+
+        size_t size = 0;
+        fread(&size, sizeof(size_t), 1, fp);
+        std::vector<size_t> indices(size);
+        if (fread(indices.data(), sizeof(size_t), size, fp) != size)
+        {
+            fclose(fp);
+            throw "Truncated index file: " + filename;
+        }
 
         fclose(fp);
 
-        return connectivity;
+        return indices;
     }
 
     template <size_t DIMENSION>
     PointCloud<DIMENSION>* loadFromPCL(const std::string &filename, bool importConnectivity = true,
                                        bool importGeometry = true)
     {
+        TraceScope trace("PointCloudIO::loadFromPCL");
         FILE *fp = fopen(filename.c_str(), "rb");
         if (fp == NULL)
             throw "Could not open file: " + filename;
@@ -421,7 +786,7 @@ public:
         if (importGeometry)
         {
             std::string geometryFilename = filename.substr(0, filename.find_last_of('.')) + ".geo";
-            Geometry *geometry = loadGeometry(geometryFilename);
+            Geometry *geometry = loadGeometry(geometryFilename, points.size());
             if (geometry != NULL) pointCloud->geometry(geometry);
         }
 
@@ -430,6 +795,7 @@ public:
 
     PointCloud3d* loadFromPoints(const std::string &filename)
     {
+        TraceScope trace("PointCloudIO::loadFromPoints");
         FILE *fp = fopen(filename.c_str(), "rb");
         if (fp == NULL)
             throw "Could not open file: " + filename;
@@ -468,86 +834,476 @@ public:
 
     PointCloud3d* loadFromXYZ(const std::string &filename)
     {
-        std::ifstream input(filename.c_str());
-        if (!input.good())
-            throw "Could not open file: " + filename;
+        TraceScope trace("PointCloudIO::loadFromXYZ");
+        MappedFile file(filename);
+
+        // x y z [r g b], the colors in [0, 255]
+        struct Convert
+        {
+            bool hasColor = false;
+
+            bool operator()(const float *values, size_t numValues, Point3d &point)
+            {
+                if (numValues < 3) return false;
+                Eigen::Vector3f color = Eigen::Vector3f::Zero();
+                if (numValues >= 6) color = Eigen::Vector3f(values[3], values[4], values[5]) / 255.0f;
+                if (color.x() > 0 || color.y() > 0 || color.z() > 0) hasColor = true;
+                point = Point3d(Eigen::Vector3f(values[0], values[1], values[2]), color);
+                return true;
+            }
+        };
 
         std::vector<Point3d> points;
+        std::vector<Convert> chunks = AsciiParser::parse(file.data(), file.size(), 6, points, Convert());
         bool hasColor = false;
-        std::string line;
-        std::setlocale(LC_NUMERIC, "en_US.UTF-8");
-        while (std::getline(input, line))
+        for (const Convert &chunk : chunks)
         {
-            float x, y, z, r = 0, g = 0, b = 0;
-            sscanf(line.c_str(), "%f %f %f %f %f %f", &x, &y, &z, &r, &g, &b);
-            r /= 255.0f;
-            g /= 255.0f;
-            b /= 255.0f;
-            if (r > 0 || g > 0 || b > 0) hasColor = true;
-            points.push_back(Point3d(Eigen::Vector3f(x, y, z), Eigen::Vector3f(r, g, b)));
+            hasColor = hasColor || chunk.hasColor;
         }
 
-        input.close();
-
         if (hasColor)
             return new PointCloud3d(points, PointCloud3d::Mode::COLOR);
         else
             return new PointCloud3d(points);
     }
 
+    /**
+     * @brief Loads a '.ptx' file. Each scan of an organized PTX is a header (number of columns and rows,
+     * scanner position, scanner axes and the 4x4 registration transform) followed by one line per cell,
+     * column by column. The points are registered with the transform and the grid of every scan is kept in
+     * PointCloud::scans(); empty cells (written as 0 0 0) are dropped. Files without headers are read as an
+     * unorganized list of points.
+     */
     PointCloud3d* loadFromPTX(const std::string &filename)
     {
-        std::ifstream input(filename.c_str());
-        if (!input.good())
-            throw "Could not open file: " + filename;
+        TraceScope trace("PointCloudIO::loadFromPTX");
+        MappedFile file(filename);
 
-        //setlocale(LC_ALL, ".OCP");
+        // x y z [intensity [r g b]], the colors in [0, 255]. in a scan, every line is kept so the rows match the cells
+        struct Convert
+        {
+            bool organized = false;
+            bool hasIntensity = false;
+            bool hasColor = false;
+
+            bool operator()(const float *values, size_t numValues, Point3d &point)
+            {
+                if (numValues < 3)
+                {
+                    point = Point3d();
+                    return organized;
+                }
+                float intensity = numValues >= 4 ? values[3] : 0;
+                Eigen::Vector3f color = Eigen::Vector3f::Zero();
+                if (numValues >= 7) color = Eigen::Vector3f(values[4], values[5], values[6]) / 255.0f;
+                if (intensity > 0) hasIntensity = true;
+                if (color.x() > 0 || color.y() > 0 || color.z() > 0) hasColor = true;
+                point = Point3d(Eigen::Vector3f(values[0], values[1], values[2]), color, intensity);
+                return true;
+            }
+        };
 
         std::vector<Point3d> points;
+        std::vector<ScanGrid> scans;
         bool hasIntensity = false;
         bool hasColor = false;
-        std::string line;
-        //int count = 0;
-        std::locale("En_US");
-        while (std::getline(input, line))
-        {
-            float x, y, z, intensity = 0, r = 0, g = 0, b = 0;
-            std::stringstream ss;
-            ss << line;
-            ss >> x >> y >> z;
-            if (!ss.eof())
-            {
-                ss >> intensity;
-                if (!ss.eof())
-                {
-                    ss >> r >> g >> b;
-                }
+        const char *p = file.data();
+        const char *end = p + file.size();
+        while (true)
+        {
+            while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) p++;
+            if (p == end) break;
+            const char *scanStart = p;
+            size_t columns, rows;
+            Eigen::Vector3f origin;
+            Eigen::Matrix4f transform;
+            if (!parsePTXHeader(p, end, columns, rows, origin, transform))
+            {
+                // a file without headers is a list of points
+                if (!scans.empty())
+                    throw "Invalid PTX scan header: " + filename;
+                p = scanStart;
+                break;
+            }
+            const char *bodyEnd = AsciiParser::skipLines(p, end, columns * rows);
+            Convert organized;
+            organized.organized = true;
+            std::vector<Point3d> cells;
+            std::vector<Convert> chunks = AsciiParser::parse(p, bodyEnd - p, 7, cells, organized);
+            if (cells.size() != columns * rows)
+                throw "Truncated PTX scan: " + filename;
+            p = bodyEnd;
+
+            // the axes are swapped as for the unorganized files, so the scans stay in the same frame
+            ScanGrid scan(columns, rows, Eigen::Vector3f(origin.x(), origin.z(), -origin.y()), transform);
+            points.reserve(points.size() + cells.size());
+            for (size_t i = 0; i < cells.size(); i++)
+            {
+                const Eigen::Vector3f &local = cells[i].position();
+                if (local.isZero()) continue;
+                Eigen::Vector3f registered = (transform * local.homogeneous()).head<3>();
+                scan.set(i % rows, i / rows, points.size());
+                points.push_back(Point3d(Eigen::Vector3f(registered.x(), registered.z(), -registered.y()), cells[i].color(), cells[i].intensity()));
+            }
+            scans.push_back(scan);
+            for (const Convert &chunk : chunks)
+            {
+                hasIntensity = hasIntensity || chunk.hasIntensity;
+                hasColor = hasColor || chunk.hasColor;
             }
-            //sscanf(line.c_str(), "%f %f %f %f %f %f %f", &x, &y, &z, &intensity, &r, &g, &b);
-            r /= 255.0f;
-            g /= 255.0f;
-            b /= 255.0f;
-            if (intensity > 0) hasIntensity = true;
-            if (r > 0 || g > 0 || b > 0) hasColor = true;
-            points.push_back(Point3d(Eigen::Vector3f(x, z, -y), Eigen::Vector3f(r, g, b), intensity));
-            //std::cout << x << " " << y << " " << z << " " << line << std::endl;
-            //if (count++ > 10) getchar();
         }
 
-        input.close();
+        if (scans.empty())
+        {
+            std::vector<Convert> chunks = AsciiParser::parse(p, end - p, 7, points, Convert());
+            for (Point3d &point : points)
+            {
+                const Eigen::Vector3f &position = point.position();
+                point.position(Eigen::Vector3f(position.x(), position.z(), -position.y()));
+            }
+            for (const Convert &chunk : chunks)
+            {
+                hasIntensity = hasIntensity || chunk.hasIntensity;
+                hasColor = hasColor || chunk.hasColor;
+            }
+        }
 
+        PointCloud3d *pointCloud;
         if (hasColor && hasIntensity)
-            return new PointCloud3d(points, PointCloud3d::Mode::COLOR | PointCloud3d::Mode::INTENSITY);
+            pointCloud = new PointCloud3d(points, PointCloud3d::Mode::COLOR | PointCloud3d::Mode::INTENSITY);
         else if (hasColor)
-            return new PointCloud3d(points, PointCloud3d::Mode::COLOR);
+            pointCloud = new PointCloud3d(points, PointCloud3d::Mode::COLOR);
         else
-            return new PointCloud3d(points);
+            pointCloud = new PointCloud3d(points);
+        pointCloud->scans(scans);
+        return pointCloud;
+    }
+
+    /**
+     * @brief Loads a '.pcb' file. The columns are read straight from the mapped file in a single pass.
+     */
+    PointCloud3d* loadFromPCB(const std::string &filename, bool importConnectivity = true, bool importGeometry = true)
+    {
+        TraceScope trace("PointCloudIO::loadFromPCB");
+        MappedPointCloud mapped(filename);
+        size_t size = mapped.size();
+        const float *positions = mapped.positions();
+        if (positions == NULL)
+            throw "No positions in file: " + filename;
+        const float *colors = mapped.colors();
+        const float *intensities = mapped.intensities();
+        const float *normals = mapped.normals();
+        const float *normalConfidences = mapped.normalConfidences();
+        const float *curvatures = mapped.curvatures();
+
+        std::vector<Point3d> points;
+        points.reserve(size);
+        for (size_t i = 0; i < size; i++)
+        {
+            points.push_back(Point3d(Eigen::Vector3f(positions + 3 * i),
+                                     colors != NULL ? Eigen::Vector3f(colors + 3 * i) : Eigen::Vector3f::Zero(),
+                                     intensities != NULL ? intensities[i] : 0,
+                                     normals != NULL ? Eigen::Vector3f(normals + 3 * i) : Eigen::Vector3f::Zero(),
+                                     normalConfidences != NULL ? normalConfidences[i] : 0,
+                                     curvatures != NULL ? curvatures[i] : 0));
+        }
+        PointCloud3d *pointCloud = new PointCloud3d(points, mapped.mode());
+
+        const uint64_t *offsets = mapped.connectivityOffsets();
+        if (importConnectivity && offsets != NULL)
+        {
+            const uint64_t *neighbors = mapped.connectivityNeighbors();
+            ConnectivityGraph *connectivity = new ConnectivityGraph(size);
+            connectivity->setEdges(std::vector<size_t>(offsets, offsets + size + 1), std::vector<size_t>(neighbors, neighbors + offsets[size]));
+            const uint64_t *groups = mapped.connectivityGroups();
+            if (groups != NULL)
+                connectivity->setGroupIndices(std::vector<size_t>(groups, groups + size));
+            pointCloud->connectivity(connectivity);
+        }
+
+        if (importGeometry && mapped.geometryOffset() != 0)
+        {
+            FILE *fp = fopen(filename.c_str(), "rb");
+            if (fp != NULL)
+            {
+                fseek(fp, long(mapped.geometryOffset()), SEEK_SET);
+                try
+                {
+                    pointCloud->geometry(loadGeometry(fp, size));
+                }
+                catch (...)
+                {
+                    fclose(fp);
+                    delete pointCloud;
+                    throw;
+                }
+                fclose(fp);
+            }
+        }
+
+        return pointCloud;
+    }
+
+    /**
+     * @brief Loads a '.ply' file (ASCII or binary). The vertex properties x/y/z, nx/ny/nz, red/green/blue,
+     * intensity, confidence and curvature are mapped onto the points, the other properties and elements are
+     * ignored.
+     */
+    PointCloud3d* loadFromPLY(const std::string &filename)
+    {
+        TraceScope trace("PointCloudIO::loadFromPLY");
+        MappedFile file(filename);
+        PLYFormat::Header header = PLYFormat::parseHeader(file.data(), file.size());
+        bool swap = header.format != PLYFormat::ASCII && (header.format == PLYFormat::BINARY_LITTLE_ENDIAN) != PLYFormat::isLittleEndian();
+        const char *p = file.data() + header.size;
+        const char *end = file.data() + file.size();
+
+        // elements written before the vertices are skipped
+        size_t e = 0;
+        for (; e < header.elements.size() && header.elements[e].name != "vertex"; e++)
+        {
+            const PLYFormat::Element &element = header.elements[e];
+            if (header.format == PLYFormat::ASCII)
+            {
+                p = AsciiParser::skipLines(p, end, element.count);
+            }
+            else if (element.stride > 0)
+            {
+                if (element.stride * element.count > size_t(end - p))
+                    throw "Truncated PLY file: " + filename;
+                p += element.stride * element.count;
+            }
+            else
+            {
+                for (size_t i = 0; i < element.count; i++)
+                {
+                    p = PLYFormat::skip(p, end, element, swap);
+                }
+            }
+        }
+        if (e == header.elements.size())
+            throw "No vertices in file: " + filename;
+        const PLYFormat::Element &vertex = header.elements[e];
+        if (vertex.hasLists())
+            throw "PLY vertices with list properties are not supported: " + filename;
+
+        // the vertex property of each attribute: x, y, z, nx, ny, nz, red, green, blue, intensity, confidence, curvature
+        struct Convert
+        {
+            int properties[12];
+            int maxProperty;
+            float colorScale;
+
+            bool operator()(const float *values, size_t numValues, Point3d &point)
+            {
+                if (int(numValues) <= maxProperty) return false;
+                float attributes[12];
+                for (size_t i = 0; i < 12; i++)
+                {
+                    attributes[i] = properties[i] >= 0 ? values[properties[i]] : 0;
+                }
+                point = Point3d(Eigen::Vector3f(attributes[0], attributes[1], attributes[2]),
+                                Eigen::Vector3f(attributes[6], attributes[7], attributes[8]) * colorScale, attributes[9],
+                                Eigen::Vector3f(attributes[3], attributes[4], attributes[5]), attributes[10], attributes[11]);
+                return true;
+            }
+        };
+        Convert convert;
+        const std::initializer_list<const char*> names[] = { { "x" }, { "y" }, { "z" }, { "nx", "normal_x" }, { "ny", "normal_y" }, { "nz", "normal_z" },
+                                                             { "red", "r", "diffuse_red" }, { "green", "g", "diffuse_green" }, { "blue", "b", "diffuse_blue" },
+                                                             { "intensity", "scalar_intensity" }, { "confidence", "normal_confidence" }, { "curvature", "scalar_curvature" } };
+        convert.maxProperty = -1;
+        for (size_t i = 0; i < 12; i++)
+        {
+            convert.properties[i] = vertex.property(names[i]);
+            convert.maxProperty = std::max(convert.maxProperty, convert.properties[i]);
+        }
+        if (convert.properties[0] < 0 || convert.properties[1] < 0 || convert.properties[2] < 0)
+            throw "No positions in file: " + filename;
+        size_t mode = 0;
+        if (convert.properties[3] >= 0 && convert.properties[4] >= 0 && convert.properties[5] >= 0) mode |= PointCloud3d::NORMAL;
+        if (convert.properties[6] >= 0 && convert.properties[7] >= 0 && convert.properties[8] >= 0) mode |= PointCloud3d::COLOR;
+        if (convert.properties[9] >= 0) mode |= PointCloud3d::INTENSITY;
+        if (convert.properties[10] >= 0) mode |= PointCloud3d::NORMAL_CONFIDENCE;
+        if (convert.properties[11] >= 0) mode |= PointCloud3d::CURVATURE;
+        convert.colorScale = 1;
+        if (convert.properties[6] >= 0)
+        {
+            PLYFormat::Type colorType = vertex.properties[convert.properties[6]].type;
+            if (colorType == PLYFormat::UINT8) convert.colorScale = 1 / 255.0f;
+            else if (colorType == PLYFormat::UINT16) convert.colorScale = 1 / 65535.0f;
+        }
+
+        std::vector<Point3d> points;
+        if (header.format == PLYFormat::ASCII)
+        {
+            if (size_t(convert.maxProperty) >= AsciiParser::MAX_COLUMNS)
+                throw "Too many PLY vertex properties: " + filename;
+            const char *verticesEnd = AsciiParser::skipLines(p, end, vertex.count);
+            AsciiParser::parse(p, verticesEnd - p, convert.maxProperty + 1, points, convert);
+        }
+        else
+        {
+            // the vertices are decoded in place, straight from the mapped file
+            if (vertex.stride * vertex.count > size_t(end - p))
+                throw "Truncated PLY file: " + filename;
+            points.resize(vertex.count);
+            std::vector<float> values(convert.maxProperty + 1, 0);
+            for (size_t i = 0; i < vertex.count; i++)
+            {
+                const char *data = p + i * vertex.stride;
+                for (size_t j = 0; j < 12; j++)
+                {
+                    if (convert.properties[j] < 0) continue;
+                    const PLYFormat::Property &property = vertex.properties[convert.properties[j]];
+                    values[convert.properties[j]] = float(PLYFormat::read(data + property.offset, property.type, swap));
+                }
+                convert(values.data(), values.size(), points[i]);
+            }
+        }
+
+        return new PointCloud3d(points, mode);
+    }
+
+    /**
+     * @brief Loads an uncompressed '.las' file. The records are decoded in parallel chunks straight into the
+     * points, with their intensity (scaled to [0, 1]) and their color for the point formats that have one. If
+     * classes is not empty, only the points of these classifications are loaded. Coordinates are scaled and
+     * offset in double and the local origin (see localOrigin) is subtracted before they are stored as floats,
+     * which georeferenced coordinates need to keep their precision. The subtracted origin is kept in origin() and
+     * in the origin of the geometry of the point cloud, so the detections saved from it record it.
+     */
+    PointCloud3d* loadFromLAS(const std::string &filename, const std::vector<uint8_t> &classes = std::vector<uint8_t>(),
+                              bool useLocalOrigin = true)
+    {
+        TraceScope trace("PointCloudIO::loadFromLAS");
+        MappedFile file(filename);
+        const LASFormat::Header header = LASFormat::readHeader(file.data(), file.size());
+        if (header.offsetToPoints > file.size() || header.numPoints > (file.size() - header.offsetToPoints) / header.recordLength)
+            throw "Truncated LAS file: " + filename;
+        const char *records = file.data() + header.offsetToPoints;
+        const Eigen::Vector3d origin = useLocalOrigin ? localOrigin(header) : Eigen::Vector3d::Zero();
+        mOrigin = origin;
+        bool hasColor = LASFormat::colorOffset(header.pointFormat) != 0;
+        std::vector<bool> selected(256, classes.empty());
+        for (const uint8_t &classification : classes)
+        {
+            selected[classification] = true;
+        }
+
+        size_t numChunks = std::max<size_t>(1, std::min<size_t>(Parallel::numThreads(), header.numPoints >> 16));
+        size_t chunkSize = (header.numPoints + numChunks - 1) / numChunks;
+        // counts the points each chunk keeps first, so every chunk decodes straight to its place
+        std::vector<size_t> offsets(numChunks + 1, 0);
+        Parallel::run(numChunks, [&](size_t c) {
+            size_t end = std::min<size_t>(header.numPoints, (c + 1) * chunkSize);
+            size_t count = 0;
+            for (size_t i = c * chunkSize; i < end; i++)
+            {
+                if (selected[LASFormat::classification(records + i * header.recordLength, header.pointFormat)]) count++;
+            }
+            offsets[c + 1] = count;
+        });
+        for (size_t c = 0; c < numChunks; c++)
+        {
+            offsets[c + 1] += offsets[c];
+        }
+
+        std::vector<Point3d> points(offsets.back());
+        std::vector<uint16_t> maxColor(numChunks, 0);
+        std::vector<char> hasIntensity(numChunks, 0);
+        Parallel::run(numChunks, [&](size_t c) {
+            TraceScope trace("PointCloudIO::decodeLAS");
+            size_t end = std::min<size_t>(header.numPoints, (c + 1) * chunkSize);
+            Point3d *point = points.data() + offsets[c];
+            for (size_t i = c * chunkSize; i < end; i++)
+            {
+                const char *record = records + i * header.recordLength;
+                if (!selected[LASFormat::classification(record, header.pointFormat)]) continue;
+                int32_t coordinates[3];
+                LASFormat::position(record, coordinates);
+                Eigen::Vector3f position;
+                for (size_t k = 0; k < 3; k++)
+                {
+                    position(k) = float(coordinates[k] * header.scale[k] + header.offset[k] - origin(k));
+                }
+                uint16_t intensity = LASFormat::intensity(record);
+                if (intensity > 0) hasIntensity[c] = 1;
+                Eigen::Vector3f color = Eigen::Vector3f::Zero();
+                if (hasColor)
+                {
+                    uint16_t rgb[3];
+                    LASFormat::color(record, header.pointFormat, rgb);
+                    maxColor[c] = std::max(maxColor[c], std::max(rgb[0], std::max(rgb[1], rgb[2])));
+                    color = Eigen::Vector3f(rgb[0], rgb[1], rgb[2]) / 65535.0f;
+                }
+                *point++ = Point3d(position, color, intensity / 65535.0f);
+            }
+        });
+
+        // colors should be 16 bit, but many files store them in 8 bits
+        uint16_t maxAllColors = *std::max_element(maxColor.begin(), maxColor.end());
+        if (maxAllColors > 0 && maxAllColors <= 255)
+        {
+            for (Point3d &point : points)
+            {
+                point.color(point.color() * (65535.0f / 255.0f));
+            }
+        }
+
+        size_t mode = 0;
+        if (maxAllColors > 0) mode |= PointCloud3d::COLOR;
+        if (std::find(hasIntensity.begin(), hasIntensity.end(), 1) != hasIntensity.end()) mode |= PointCloud3d::INTENSITY;
+        PointCloud3d *pointCloud = new PointCloud3d(points, mode);
+        pointCloud->geometry()->origin(origin);
+        return pointCloud;
+    }
+
+    /**
+     * @brief Classifications of the '.las' files kept by load() (all of them when empty)
+     */
+    void lasClasses(const std::vector<uint8_t> &classes)
+    {
+        mLASClasses = classes;
+    }
+
+    const std::vector<uint8_t>& lasClasses() const
+    {
+        return mLASClasses;
+    }
+
+    /**
+     * @brief Origin subtracted from the coordinates of the last point cloud loaded (zero but for '.las' files).
+     * Adding it back in double gives the coordinates of the file.
+     */
+    const Eigen::Vector3d& origin() const
+    {
+        return mOrigin;
+    }
+
+    /**
+     * @brief Origin load() subtracts from the coordinates of a file, read from its header only (e.g. for a point
+     * cloud read back from a cache)
+     */
+    Eigen::Vector3d localOrigin(const std::string &filename)
+    {
+        std::string extension = filename.substr(filename.find_last_of('.') + 1);
+        if (extension != "las") return Eigen::Vector3d::Zero();
+        FILE *fp = fopen(filename.c_str(), "rb");
+        if (fp == NULL)
+            throw "Could not open file: " + filename;
+        // 375 bytes is the biggest header (LAS 1.4)
+        char data[375];
+        size_t size = fread(data, 1, sizeof(data), fp);
+        fclose(fp);
+        return localOrigin(LASFormat::readHeader(data, size));
     }
 
     PointCloud3d* load(const std::string &filename)
     {
         std::string extension = filename.substr(filename.find_last_of('.') + 1);
         PointCloud3d *pointCloud;
+        mOrigin = Eigen::Vector3d::Zero();
         if (extension == "pcl")
         {
             pointCloud = PointCloudIO::loadFromPCL<3>(filename);
@@ -565,13 +1321,289 @@ public:
         {
             pointCloud = PointCloudIO::loadFromPTX(filename);
         }
+        else if (extension == "pcb")
+        {
+            pointCloud = PointCloudIO::loadFromPCB(filename);
+        }
+        else if (extension == "ply")
+        {
+            pointCloud = PointCloudIO::loadFromPLY(filename);
+        }
+        else if (extension == "las")
+        {
+            pointCloud = PointCloudIO::loadFromLAS(filename, mLASClasses);
+        }
         else
         {
-            throw "Extension not supported: " + extension;
+            // other text exports ('.txt', '.pts', '.asc'...) hold one 'x y z [r g b]' point per line as well
+            pointCloud = PointCloudIO::loadFromXYZ(filename);
         }
         return pointCloud;
     }
 
+private:
+    // header of the CSR connectivity files. legacy files start with the neighbor count of the first point instead
+    struct ConnectivityHeader
+    {
+        char magic[6];
+        uint16_t version;
+        uint32_t flags;
+        uint32_t reserved;
+        uint64_t numPoints;
+        uint64_t numEdges;
+    };
+
+    enum ConnectivityFlags
+    {
+        CONNECTIVITY_DISTANCES = 1,
+        CONNECTIVITY_GROUPS = 2
+    };
+
+    static const uint16_t CONNECTIVITY_VERSION = 1;
+
+    // header of the '.geo' files since version 2 (followed by the origin as 3 doubles since version 3). legacy
+    // files start with the number of circles instead
+    struct GeometryHeader
+    {
+        char magic[6];
+        uint16_t version;
+    };
+
+    // inliers of a primitive in a version 2 '.geo' file, followed by the encoded bytes
+    struct InlierBlock
+    {
+        uint64_t numInliers;
+        uint64_t numBytes;
+        uint32_t encoding;
+        uint32_t reserved;
+    };
+
+    static const uint16_t GEOMETRY_VERSION = 3;
+
+    // header of the '.pln' plane tables
+    struct PlaneTableHeader
+    {
+        char magic[6];
+        uint16_t version;
+        uint64_t numPlanes;
+        uint64_t numPoints;
+        double origin[3];
+    };
+
+    struct PlaneRecord
+    {
+        float normal[3];
+        float center[3];
+        float basisU[3];
+        float basisV[3];
+        float color[3];
+        uint32_t reserved;
+        uint64_t numPoints;
+    };
+
+    static const uint16_t PLANE_TABLE_VERSION = 2;
+
+    static void writeInliers(const std::vector<size_t> &inliers, FILE *fp)
+    {
+        std::vector<uint8_t> bytes;
+        InlierBlock block;
+        block.encoding = InlierCodec::encode(inliers, bytes);
+        block.numInliers = inliers.size();
+        block.numBytes = bytes.size();
+        block.reserved = 0;
+        fwrite(&block, sizeof(block), 1, fp);
+        fwrite(bytes.data(), 1, bytes.size(), fp);
+    }
+
+    void readGeometry(FILE *fp, size_t numPoints, Geometry *geometry)
+    {
+        uint64_t end = fileEnd(fp);
+
+        // legacy files (version 1) have no header and start with the number of circles
+        GeometryHeader header;
+        if (fread(&header, sizeof(header), 1, fp) != 1) return;
+        bool compressed = memcmp(header.magic, "GEOINL", sizeof(header.magic)) == 0;
+        if (compressed && header.version > GEOMETRY_VERSION)
+            throw std::string("Incompatible geometry file");
+        if (!compressed) fseek(fp, -long(sizeof(header)), SEEK_CUR);
+        if (compressed && header.version >= 3)
+        {
+            Eigen::Vector3d origin;
+            if (fread(origin.data(), sizeof(double), 3, fp) != 3)
+                throw std::string("Truncated geometry file");
+            geometry->origin(origin);
+        }
+        // the smallest inlier list: its count, or an empty block
+        size_t minInliersSize = compressed ? sizeof(InlierBlock) : sizeof(size_t);
+
+        size_t numCircles = readCount(fp, end, 6 * sizeof(float) + minInliersSize);
+        for (size_t i = 0; i < numCircles; i++)
+        {
+            float color[3];
+            float center[2];
+            float radius;
+            if (fread(color, sizeof(float), 3, fp) != 3 || fread(center, sizeof(float), 2, fp) != 2 ||
+                    fread(&radius, sizeof(float), 1, fp) != 1)
+                throw std::string("Truncated geometry file");
+            std::vector<size_t> inliers = readInliers(fp, compressed, end, numPoints);
+            Circle *circle = new Circle(Eigen::Vector2f(center), radius);
+            circle->color(Eigen::Vector3f(color));
+            circle->inliers(inliers);
+            geometry->addCircle(circle);
+        }
+
+        size_t numPlanes = readCount(fp, end, 15 * sizeof(float) + minInliersSize);
+        for (size_t i = 0; i < numPlanes; i++)
+        {
+            float color[3];
+            float center[3];
+            float normal[3];
+            float basisU[3];
+            float basisV[3];
+            if (fread(color, sizeof(float), 3, fp) != 3 || fread(center, sizeof(float), 3, fp) != 3 ||
+                    fread(normal, sizeof(float), 3, fp) != 3 || fread(basisU, sizeof(float), 3, fp) != 3 ||
+                    fread(basisV, sizeof(float), 3, fp) != 3)
+                throw std::string("Truncated geometry file");
+            std::vector<size_t> inliers = readInliers(fp, compressed, end, numPoints);
+            Plane *plane = new Plane(Eigen::Vector3f(center), Eigen::Vector3f(normal),
+                                     Eigen::Vector3f(basisU), Eigen::Vector3f(basisV));
+            plane->color(Eigen::Vector3f(color));
+            plane->inliers(inliers);
+            geometry->addPlane(plane);
+        }
+
+        size_t numCylinders = readCount(fp, end, 11 * sizeof(float) + minInliersSize);
+        for (size_t i = 0; i < numCylinders; i++)
+        {
+            float color[3];
+            float center[3];
+            float axis[3];
+            float radius;
+            float height;
+            if (fread(color, sizeof(float), 3, fp) != 3 || fread(center, sizeof(float), 3, fp) != 3 ||
+                    fread(axis, sizeof(float), 3, fp) != 3 || fread(&radius, sizeof(float), 1, fp) != 1 ||
+                    fread(&height, sizeof(float), 1, fp) != 1)
+                throw std::string("Truncated geometry file");
+            std::vector<size_t> inliers = readInliers(fp, compressed, end, numPoints);
+            Cylinder *cylinder = new Cylinder(Eigen::Vector3f(center), Eigen::Vector3f(axis),
+                                              radius, height);
+            cylinder->color(Eigen::Vector3f(color));
+            cylinder->inliers(inliers);
+            geometry->addCylinder(cylinder);
+        }
+    }
+
+    // a count of records of at least recordSize bytes each, which the rest of the file must be able to hold
+    static size_t readCount(FILE *fp, uint64_t end, size_t recordSize)
+    {
+        size_t count;
+        if (fread(&count, sizeof(size_t), 1, fp) != 1)
+            throw std::string("Truncated geometry file");
+        uint64_t position = filePosition(fp);
+        if (count > (end > position ? end - position : 0) / recordSize)
+            throw std::string("Truncated geometry file");
+        return count;
+    }
+
+    static std::vector<size_t> readInliers(FILE *fp, bool compressed, uint64_t end, size_t numPoints)
+    {
+        std::vector<size_t> inliers;
+        if (!compressed)
+        {
+            size_t numInliers = readCount(fp, end, sizeof(size_t));
+            inliers.resize(numInliers);
+            if (fread(inliers.data(), sizeof(size_t), numInliers, fp) != numInliers)
+                throw std::string("Truncated geometry file");
+            for (const size_t &inlier : inliers)
+            {
+                if (inlier >= numPoints)
+                    throw std::string("Corrupted geometry file");
+            }
+            return inliers;
+        }
+        InlierBlock block;
+        if (fread(&block, sizeof(block), 1, fp) != 1)
+            throw std::string("Truncated geometry file");
+        uint64_t position = filePosition(fp);
+        if (block.numBytes > (end > position ? end - position : 0))
+            throw std::string("Truncated geometry file");
+        // the inliers are distinct points
+        if (block.numInliers > numPoints || block.encoding > InlierCodec::RANGES)
+            throw std::string("Corrupted geometry file");
+        std::vector<uint8_t> bytes(block.numBytes);
+        if (fread(bytes.data(), 1, bytes.size(), fp) != bytes.size())
+            throw std::string("Truncated geometry file");
+        InlierCodec::decode(bytes.data(), bytes.size(), InlierCodec::Encoding(block.encoding), block.numInliers, inliers);
+        if (!inliers.empty() && inliers.back() >= numPoints)
+            throw std::string("Corrupted geometry file");
+        return inliers;
+    }
+
+    static bool parsePTXHeader(const char *&p, const char *end, size_t &columns, size_t &rows,
+                               Eigen::Vector3f &origin, Eigen::Matrix4f &transform)
+    {
+        // columns, rows, scanner position, the 3 scanner axes and the transform (transposed, one row per line)
+        const size_t numValues[] = { 1, 1, 3, 3, 3, 3, 4, 4, 4, 4 };
+        float values[5];
+        for (size_t line = 0; line < 10; line++)
+        {
+            if (AsciiParser::parseLine(p, end, values, 5) != numValues[line]) return false;
+            if (line == 0) columns = size_t(values[0]);
+            else if (line == 1) rows = size_t(values[0]);
+            else if (line == 2) origin = Eigen::Vector3f(values[0], values[1], values[2]);
+            else if (line >= 6) transform.col(line - 6) = Eigen::Vector4f(values[0], values[1], values[2], values[3]);
+        }
+        return columns > 0 && rows > 0;
+    }
+
+    // the minimum of the bounding box, rounded down to the meter so the local coordinates stay readable
+    static Eigen::Vector3d localOrigin(const LASFormat::Header &header)
+    {
+        Eigen::Vector3d origin;
+        for (size_t k = 0; k < 3; k++)
+        {
+            origin(k) = std::isfinite(header.min[k]) ? std::floor(header.min[k]) : 0.0;
+        }
+        return origin;
+    }
+
+    static uint64_t filePosition(FILE *fp)
+    {
+#ifdef _WIN32
+        return uint64_t(_ftelli64(fp));
+#else
+        return uint64_t(ftello(fp));
+#endif
+    }
+
+    // size of the file, the position is kept
+    static uint64_t fileEnd(FILE *fp)
+    {
+        uint64_t position = filePosition(fp);
+#ifdef _WIN32
+        _fseeki64(fp, 0, SEEK_END);
+        uint64_t end = filePosition(fp);
+        _fseeki64(fp, __int64(position), SEEK_SET);
+#else
+        fseeko(fp, 0, SEEK_END);
+        uint64_t end = filePosition(fp);
+        fseeko(fp, off_t(position), SEEK_SET);
+#endif
+        return end;
+    }
+
+    static bool skipBytes(FILE *fp, uint64_t bytes)
+    {
+#ifdef _WIN32
+        return _fseeki64(fp, __int64(bytes), SEEK_CUR) == 0;
+#else
+        return fseeko(fp, off_t(bytes), SEEK_CUR) == 0;
+#endif
+    }
+
+    Eigen::Vector3d mOrigin;
+    std::vector<uint8_t> mLASClasses;
+
 };
 
 #endif // POINTCLOUDLOADER_H
@@ -0,0 +1,87 @@
+#ifndef PREPROCESSING_H
+#define PREPROCESSING_H
+
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "pointcloud.h"
+#include "connectivitygraph.h"
+#include "boundaryvolumehierarchy.h"
+#include "normalestimator.h"
+#include "gridnormalestimator.h"
+#include "trace.h"
+
+/**
+ * @brief Normal estimation done on every point cloud before the detection, shared by the command line tools
+ * so they all detect on the same normals and connectivity (and the cache key describes all of them).
+ */
+class Preprocessing
+{
+public:
+    // partition of the octree searched for the nearest neighbors of unorganized point clouds
+    static const size_t OCTREE_LEVELS = 10;
+    static const size_t OCTREE_MIN_POINTS = 30;
+
+    /**
+     * @brief Description of every setting of estimateNormals, and of the classifications kept from '.las' files,
+     * used as the key of the cached point clouds (see SceneCache)
+     */
+    static std::string settings(size_t numNeighbors, const std::vector<uint8_t> &lasClasses = std::vector<uint8_t>())
+    {
+        GridNormalEstimator gridEstimator(NULL, numNeighbors);
+        std::ostringstream settings;
+        settings << "octree=" << size_t(OCTREE_LEVELS) << "/" << size_t(OCTREE_MIN_POINTS) << " knn=" << numNeighbors
+                 << " quick grid=" << gridEstimator.numNeighbors() << "/" << gridEstimator.windowRadius() << "/"
+                 << gridEstimator.maxRangeDiff();
+        if (!lasClasses.empty())
+        {
+            settings << " classes=";
+            for (size_t i = 0; i < lasClasses.size(); i++)
+            {
+                settings << (i > 0 ? "," : "") << int(lasClasses[i]);
+            }
+        }
+        return settings.str();
+    }
+
+    /**
+     * @brief Estimates the normal, confidence and curvature of every point and builds the connectivity graph
+     * from the numNeighbors nearest neighbors of each point. Organized scans (PTX) take the neighbors from the
+     * scan grid, no octree or kNN needed.
+     */
+    static void estimateNormals(PointCloud3d *pointCloud, size_t numNeighbors = 30, bool showProgress = false)
+    {
+        ConnectivityGraph *connectivity = new ConnectivityGraph(pointCloud->size());
+        pointCloud->connectivity(connectivity);
+        if (pointCloud->isOrganized())
+        {
+            TraceScope trace("GridNormalEstimator::estimate", "points", pointCloud->size());
+            GridNormalEstimator estimator(pointCloud, numNeighbors);
+            estimator.estimate(connectivity);
+            return;
+        }
+
+        Octree octree(pointCloud);
+        octree.partition(OCTREE_LEVELS, OCTREE_MIN_POINTS);
+        NormalEstimator3d estimator(&octree, numNeighbors, NormalEstimator3d::QUICK);
+        TraceScope trace("NormalEstimator::estimate", "points", pointCloud->size());
+        for (size_t i = 0; i < pointCloud->size(); i++)
+        {
+            if (showProgress && i % 10000 == 0)
+            {
+                std::cout << i / float(pointCloud->size()) * 100 << "%..." << std::endl;
+            }
+            NormalEstimator3d::Normal normal = estimator.estimate(i);
+            connectivity->addNode(i, normal.neighbors);
+            (*pointCloud)[i].normal(normal.normal);
+            (*pointCloud)[i].normalConfidence(normal.confidence);
+            (*pointCloud)[i].curvature(normal.curvature);
+        }
+    }
+
+};
+
+#endif // PREPROCESSING_H
@@ -0,0 +1,135 @@
+#ifndef SCENECACHE_H
+#define SCENECACHE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "mappedfile.h"
+#include "parallel.h"
+#include "trace.h"
+
+/**
+ * @brief Location of the preprocessed version of a point cloud file (e.g. with its normals and connectivity
+ * already estimated, saved as a '.pcb' file). The cache file is next to the input and its name holds a key
+ * made of the hash of the input content and of the preprocessing settings, so it is only found again when
+ * neither changed. Stale cache files are not removed.
+ */
+class SceneCache
+{
+public:
+    /**
+     * @param settings
+     *      Description of every parameter of the preprocessing (a different string gives a different key)
+     */
+    SceneCache(const std::string &inputFilename, const std::string &settings)
+    {
+        TraceScope trace("SceneCache::hash");
+        MappedFile input(inputFilename);
+        mKey = hash(input.data(), input.size(), hash(settings.data(), settings.size()));
+        char key[17];
+        snprintf(key, sizeof(key), "%016llx", static_cast<unsigned long long>(mKey));
+        mFilename = inputFilename + "." + key + ".pcb";
+    }
+
+    uint64_t key() const
+    {
+        return mKey;
+    }
+
+    const std::string& filename() const
+    {
+        return mFilename;
+    }
+
+    bool exists() const
+    {
+        FILE *fp = fopen(mFilename.c_str(), "rb");
+        if (fp == NULL) return false;
+        fclose(fp);
+        return true;
+    }
+
+    /**
+     * @brief File to write the cache to before commit() moves it in place, so an interrupted run does not
+     * leave a truncated cache behind
+     */
+    std::string temporaryFilename() const
+    {
+        return mFilename + ".tmp";
+    }
+
+    bool commit() const
+    {
+        return std::rename(temporaryFilename().c_str(), mFilename.c_str()) == 0;
+    }
+
+    /**
+     * @brief 64 bit hash of a buffer (not cryptographic). Fixed size blocks are hashed concurrently and their
+     * hashes combined in order, so the result does not depend on the number of threads.
+     */
+    static uint64_t hash(const char *data, size_t size, uint64_t seed = 0)
+    {
+        size_t numBlocks = (size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        std::vector<uint64_t> blockHashes(numBlocks);
+        size_t numThreads = std::min(Parallel::numThreads(), numBlocks);
+        Parallel::run(numThreads, [&](size_t thread) {
+            for (size_t block = thread; block < numBlocks; block += numThreads)
+            {
+                size_t begin = block * BLOCK_SIZE;
+                blockHashes[block] = hashBlock(data + begin, size - begin < BLOCK_SIZE ? size - begin : BLOCK_SIZE);
+            }
+        });
+        uint64_t h = mix(seed ^ size);
+        for (const uint64_t &blockHash : blockHashes)
+        {
+            h = mix(h ^ blockHash);
+        }
+        return h;
+    }
+
+private:
+    static const size_t BLOCK_SIZE = 1 << 22;
+
+    uint64_t mKey;
+    std::string mFilename;
+
+    inline static uint64_t mix(uint64_t h)
+    {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    static uint64_t hashBlock(const char *data, size_t size)
+    {
+        // four independent lanes, so the multiplications of consecutive words overlap
+        uint64_t lanes[4] = { 0x9e3779b97f4a7c15ULL, 0xbf58476d1ce4e5b9ULL, 0x94d049bb133111ebULL, 0x2545f4914f6cdd1dULL };
+        size_t i = 0;
+        for (; i + 32 <= size; i += 32)
+        {
+            for (size_t lane = 0; lane < 4; lane++)
+            {
+                uint64_t word;
+                memcpy(&word, data + i + 8 * lane, sizeof(word));
+                lanes[lane] = (lanes[lane] ^ word) * 0x100000001b3ULL;
+                lanes[lane] = (lanes[lane] << 31) | (lanes[lane] >> 33);
+            }
+        }
+        uint64_t h = mix(lanes[0]) ^ mix(lanes[1] + 1) ^ mix(lanes[2] + 2) ^ mix(lanes[3] + 3);
+        for (; i < size; i++)
+        {
+            h = (h ^ static_cast<unsigned char>(data[i])) * 0x100000001b3ULL;
+        }
+        return mix(h ^ size);
+    }
+
+};
+
+#endif // SCENECACHE_H
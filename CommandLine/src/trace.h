@@ -0,0 +1,222 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Timeline of scoped events exported in the Chrome trace format (chrome://tracing, Perfetto).
+ * Each thread records to its own buffer, so recording takes no lock. While tracing is disabled a scope
+ * costs a single test of the enabled flag. Save only when no traced work is running.
+ */
+class Trace
+{
+public:
+    struct Event
+    {
+        const char *name;
+        const char *argName;
+        uint64_t argValue;
+        double start;
+        double duration;
+    };
+
+    static bool enabled()
+    {
+        return enabledFlag().load(std::memory_order_relaxed);
+    }
+
+    static void enable(bool enabled)
+    {
+        if (enabled) epoch();
+        enabledFlag().store(enabled);
+    }
+
+    /**
+     * @brief Name shown for the calling thread
+     */
+    static void threadName(const std::string &name)
+    {
+        Buffer *buffer = threadBuffer();
+        std::lock_guard<std::mutex> lock(registry().mutex);
+        buffer->name = name;
+    }
+
+    /**
+     * @brief Time since tracing was first enabled, in microseconds
+     */
+    static double now()
+    {
+        std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - epoch();
+        return elapsed.count();
+    }
+
+    static void add(const Event &event)
+    {
+        threadBuffer()->events.push_back(event);
+    }
+
+    static void clear()
+    {
+        Registry &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        for (Buffer *buffer : r.buffers)
+        {
+            buffer->events.clear();
+        }
+    }
+
+    static bool save(const std::string &filename)
+    {
+        FILE *fp = fopen(filename.c_str(), "w");
+        if (fp == NULL) return false;
+        Registry &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        fprintf(fp, "{\"traceEvents\":[");
+        bool first = true;
+        for (const Buffer *buffer : r.buffers)
+        {
+            if (!buffer->name.empty())
+            {
+                fprintf(fp, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":",
+                        first ? "" : ",", buffer->id);
+                writeString(fp, buffer->name.c_str());
+                fprintf(fp, "}}");
+                first = false;
+            }
+            for (const Event &event : buffer->events)
+            {
+                fprintf(fp, "%s\n{\"name\":", first ? "" : ",");
+                writeString(fp, event.name);
+                fprintf(fp, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f", buffer->id, event.start, event.duration);
+                if (event.argName != NULL)
+                {
+                    fprintf(fp, ",\"args\":{");
+                    writeString(fp, event.argName);
+                    fprintf(fp, ":%llu}", (unsigned long long)event.argValue);
+                }
+                fprintf(fp, "}");
+                first = false;
+            }
+        }
+        fprintf(fp, "\n],\"displayTimeUnit\":\"ms\"}\n");
+        fclose(fp);
+        return true;
+    }
+
+private:
+    struct Buffer
+    {
+        unsigned int id;
+        std::string name;
+        std::vector<Event> events;
+    };
+
+    struct Registry
+    {
+        std::mutex mutex;
+        std::vector<Buffer*> buffers;
+
+        ~Registry()
+        {
+            for (Buffer *buffer : buffers)
+            {
+                delete buffer;
+            }
+        }
+    };
+
+    // set by one thread and read by every traced one
+    static std::atomic<bool>& enabledFlag()
+    {
+        static std::atomic<bool> enabled(false);
+        return enabled;
+    }
+
+    /**
+     * @brief Writes a quoted JSON string, escaping quotes, backslashes and control characters
+     */
+    static void writeString(FILE *fp, const char *string)
+    {
+        fputc('"', fp);
+        for (const char *c = string; *c != '\0'; c++)
+        {
+            if (*c == '"' || *c == '\\') fprintf(fp, "\\%c", *c);
+            else if (static_cast<unsigned char>(*c) < 0x20) fprintf(fp, "\\u%04x", static_cast<unsigned char>(*c));
+            else fputc(*c, fp);
+        }
+        fputc('"', fp);
+    }
+
+    static std::chrono::steady_clock::time_point epoch()
+    {
+        static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+        return epoch;
+    }
+
+    static Registry& registry()
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    // the buffers outlive their threads, so the events of finished workers can still be saved
+    static Buffer* threadBuffer()
+    {
+        static thread_local Buffer *buffer = NULL;
+        if (buffer == NULL)
+        {
+            buffer = new Buffer;
+            Registry &r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            buffer->id = r.buffers.size() + 1;
+            r.buffers.push_back(buffer);
+        }
+        return buffer;
+    }
+
+};
+
+/**
+ * @brief Records an event covering its lifetime. A NULL name records nothing (e.g. for recursive calls).
+ */
+class TraceScope
+{
+public:
+    TraceScope(const char *name, const char *argName = NULL, uint64_t argValue = 0)
+        : mActive(Trace::enabled() && name != NULL)
+    {
+        if (mActive)
+        {
+            mEvent.name = name;
+            mEvent.argName = argName;
+            mEvent.argValue = argValue;
+            mEvent.start = Trace::now();
+        }
+    }
+
+    ~TraceScope()
+    {
+        if (mActive)
+        {
+            mEvent.duration = Trace::now() - mEvent.start;
+            Trace::add(mEvent);
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    bool mActive;
+    Trace::Event mEvent;
+
+};
+
+#endif // TRACE_H
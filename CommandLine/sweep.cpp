@@ -0,0 +1,185 @@
+#include <pointcloudio.hpp>
+#include <planedetector.h>
+#include <planecomparator.h>
+#include <preprocessing.h>
+#include <parallel.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <atomic>
+
+// Parameter sweep: the point cloud is loaded and its normals estimated once, then the planes are detected for
+// every combination of the given minNormalDiff, maxDist and outlierRatio values, several detections running
+// concurrently (each with its own detector). With a ground truth, every detection is scored with the metrics
+// of ComparePlaneDetector. One CSV line is written per detection.
+
+struct Run
+{
+    float minNormalDiff;
+    float maxDist;
+    float outlierRatio;
+    double time;
+    size_t numPlanes;
+    PlaneComparator::Score score;
+};
+
+std::vector<float> parseList(const std::string &list)
+{
+    std::vector<float> values;
+    std::istringstream stream(list);
+    std::string value;
+    while (std::getline(stream, value, ','))
+    {
+        values.push_back(std::stof(value));
+    }
+    if (values.empty()) throw "Empty list: " + list;
+    return values;
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<float> minNormalDiffs = { 0.5f };
+    std::vector<float> maxDists = { 0.258819f };
+    std::vector<float> outlierRatios = { 0.75f };
+    std::string inputFileName;
+    std::string groundTruthFileName;
+    std::string outputFileName;
+    size_t numThreads = Parallel::numThreads();
+    size_t maxLevel = 9;
+    try
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg(argv[i]);
+            if (arg.substr(0, 2) != "--")
+            {
+                inputFileName = arg;
+                continue;
+            }
+            if (i + 1 >= argc) throw "Missing value of " + arg;
+            std::string value(argv[++i]);
+            if (arg == "--min-normal-diff") minNormalDiffs = parseList(value);
+            else if (arg == "--max-dist") maxDists = parseList(value);
+            else if (arg == "--outlier-ratio") outlierRatios = parseList(value);
+            else if (arg == "--ground-truth") groundTruthFileName = value;
+            else if (arg == "--output") outputFileName = value;
+            else if (arg == "--threads") numThreads = std::max<size_t>(1, std::stoul(value));
+            else if (arg == "--level") maxLevel = std::stoul(value);
+            else throw "Unknown option: " + arg;
+        }
+        if (inputFileName.empty()) throw std::string("Missing input point cloud");
+    }
+    catch (const std::string &error)
+    {
+        std::cerr << error << std::endl;
+        std::cerr << "Usage: <input point cloud> [--min-normal-diff <v1,v2,...>] [--max-dist <v1,v2,...>] [--outlier-ratio <v1,v2,...>] "
+                     "[--ground-truth <geometry (.geo)>] [--output <results (.csv)>] [--threads <n>] [--level <octree level of the metrics>]" << std::endl;
+        std::cerr << "Without --ground-truth, <input name>_ground_truth.geo is used if it exists" << std::endl;
+        return -1;
+    }
+    catch (const std::exception &)
+    {
+        std::cerr << "Invalid number in the arguments" << std::endl;
+        return -1;
+    }
+
+    try
+    {
+        std::cout << "Reading the point cloud..." << std::endl;
+        PointCloudIO pointCloudIO;
+        PointCloud3d *pointCloud = pointCloudIO.load(inputFileName);
+
+        std::cout << "Estimating normals..." << std::endl;
+        std::chrono::steady_clock::time_point normalsStart = std::chrono::steady_clock::now();
+        Preprocessing::estimateNormals(pointCloud);
+        std::chrono::duration<double> normalsElapsed = std::chrono::steady_clock::now() - normalsStart;
+        std::cout << pointCloud->size() << " points, normals estimated in " << normalsElapsed.count() << "s" << std::endl;
+
+        if (groundTruthFileName.empty())
+        {
+            groundTruthFileName = inputFileName.substr(0, inputFileName.find_last_of('.')) + "_ground_truth.geo";
+        }
+        Geometry *groundTruth = pointCloudIO.loadGeometry(groundTruthFileName);
+        PlaneComparator *comparator = NULL;
+        if (groundTruth != NULL)
+        {
+            std::cout << "Scoring against " << groundTruthFileName << " (" << groundTruth->numPlanes() << " planes)" << std::endl;
+            comparator = new PlaneComparator(pointCloud, groundTruth, maxLevel);
+            delete groundTruth;
+        }
+
+        std::vector<Run> runs;
+        for (const float &minNormalDiff : minNormalDiffs)
+        {
+            for (const float &maxDist : maxDists)
+            {
+                for (const float &outlierRatio : outlierRatios)
+                {
+                    Run run;
+                    run.minNormalDiff = minNormalDiff;
+                    run.maxDist = maxDist;
+                    run.outlierRatio = outlierRatio;
+                    runs.push_back(run);
+                }
+            }
+        }
+
+        // the detections only read the point cloud, the workers take the next run until there is none left
+        std::cout << "Detecting planes with " << runs.size() << " parameter sets..." << std::endl;
+        std::atomic<size_t> nextRun(0);
+        std::atomic<size_t> numDone(0);
+        Parallel::run(std::min(numThreads, runs.size()), [&](size_t) {
+            for (size_t i = nextRun++; i < runs.size(); i = nextRun++)
+            {
+                Run &run = runs[i];
+                PlaneDetector detector(pointCloud);
+                detector.minNormalDiff(run.minNormalDiff);
+                detector.maxDist(run.maxDist);
+                detector.outlierRatio(run.outlierRatio);
+                std::vector<int32_t> labels;
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                std::vector<Plane*> planes = detector.detect(labels);
+                std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                run.time = elapsed.count();
+                run.numPlanes = planes.size();
+                if (comparator != NULL) run.score = comparator->compare(labels, planes);
+                for (Plane *plane : planes) delete plane;
+                size_t done = ++numDone;
+                if (done % 10 == 0 || done == runs.size())
+                {
+                    std::cout << done << "/" << runs.size() << "..." << std::endl;
+                }
+            }
+        });
+
+        std::ofstream file;
+        if (!outputFileName.empty())
+        {
+            file.open(outputFileName.c_str());
+            if (!file.good()) throw "Could not open file: " + outputFileName;
+        }
+        std::ostream &output = outputFileName.empty() ? std::cout : file;
+        output << "min_normal_diff,max_dist,outlier_ratio,time,planes";
+        if (comparator != NULL) output << ",precision,recall,f1,correct_planes";
+        output << std::endl;
+        for (const Run &run : runs)
+        {
+            output << run.minNormalDiff << "," << run.maxDist << "," << run.outlierRatio << "," << run.time << "," << run.numPlanes;
+            if (comparator != NULL)
+            {
+                output << "," << run.score.precision << "," << run.score.recall << "," << run.score.f1 << "," << run.score.numCorrect << "/" << run.score.numGroundTruth;
+            }
+            output << std::endl;
+        }
+
+        delete comparator;
+        delete pointCloud;
+    }
+    catch (const std::string &error)
+    {
+        std::cerr << error << std::endl;
+        return -1;
+    }
+    return 0;
+}
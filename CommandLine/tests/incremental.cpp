@@ -0,0 +1,121 @@
+#include <planedetector.h>
+#include <preprocessing.h>
+#include <iostream>
+#include <random>
+
+// Checks the incremental update of a kept detection after points are erased, the way the editor does it: the
+// state is checked before the erasure, the points and their connectivity are removed, then erasePoints()
+// updates the planes in place. The erased points are then inserted back with the top of a box, and
+// insertPoints() has to give the corner back to the floor and find the box as a new plane.
+
+#define CHECK(condition) \
+    if (!(condition)) { std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #condition << std::endl; return 1; }
+
+int main()
+{
+    // a floor and a wall, 4 by 4 units, with a little noise
+    std::mt19937 random(42);
+    std::normal_distribution<float> noise(0, 0.005f);
+    PointCloud3d *pointCloud = new PointCloud3d();
+    for (size_t i = 0; i < 80; i++)
+    {
+        for (size_t j = 0; j < 80; j++)
+        {
+            float u = i * 0.05f, v = j * 0.05f;
+            pointCloud->add(Point3d(Eigen::Vector3f(u, v, noise(random))));
+            pointCloud->add(Point3d(Eigen::Vector3f(noise(random) - 0.2f, u, v + 0.2f)));
+        }
+    }
+    pointCloud->update();
+
+    Preprocessing::estimateNormals(pointCloud);
+
+    PlaneDetector detector(pointCloud);
+    detector.keepState(true);
+    std::set<Plane*> planes = detector.detect();
+    Geometry *geometry = pointCloud->geometry();
+    for (Plane *plane : planes)
+    {
+        geometry->addPlane(plane);
+    }
+    CHECK(geometry->numPlanes() == 2);
+    size_t numInliers = 0;
+    for (size_t i = 0; i < geometry->numPlanes(); i++)
+    {
+        numInliers += geometry->plane(i)->inliers().size();
+    }
+
+    // erase a corner of the floor, in decreasing order like the editor
+    CHECK(detector.hasState(geometry));
+    std::vector<size_t> removed;
+    std::vector<Eigen::Vector3f> removedPositions;
+    for (int i = int(pointCloud->size()) - 1; i >= 0; i--)
+    {
+        const Eigen::Vector3f &position = pointCloud->at(i).position();
+        if (position.x() < 1 && position.y() < 1 && position.z() < 0.1f)
+        {
+            removedPositions.push_back(position);
+            pointCloud->remove(i);
+            removed.push_back(i);
+        }
+    }
+    pointCloud->connectivity()->removeNodes(removed);
+    detector.erasePoints(geometry, removed);
+
+    CHECK(geometry->numPlanes() == 2);
+    CHECK(detector.hasState(geometry));
+    size_t numInliersAfter = 0;
+    for (size_t i = 0; i < geometry->numPlanes(); i++)
+    {
+        for (const size_t &inlier : geometry->plane(i)->inliers())
+        {
+            CHECK(inlier < pointCloud->size());
+        }
+        numInliersAfter += geometry->plane(i)->inliers().size();
+    }
+    CHECK(numInliersAfter < numInliers);
+    CHECK(numInliersAfter + removed.size() >= numInliers);
+
+    // insert the corner back and the top of a box, 1 by 1 unit, 1 unit above the floor
+    std::vector<size_t> inserted;
+    for (const Eigen::Vector3f &position : removedPositions)
+    {
+        inserted.push_back(pointCloud->size());
+        pointCloud->add(Point3d(position));
+    }
+    for (size_t i = 0; i < 20; i++)
+    {
+        for (size_t j = 0; j < 20; j++)
+        {
+            inserted.push_back(pointCloud->size());
+            pointCloud->add(Point3d(Eigen::Vector3f(2 + i * 0.05f, 2 + j * 0.05f, 1 + noise(random))));
+        }
+    }
+    pointCloud->update();
+    Preprocessing::estimateNormals(pointCloud);
+    detector.insertPoints(geometry, inserted);
+
+    CHECK(geometry->numPlanes() == 3);
+    CHECK(detector.hasState(geometry));
+    size_t numInliersInserted = 0;
+    size_t numBoxInliers = 0;
+    for (size_t i = 0; i < geometry->numPlanes(); i++)
+    {
+        const Plane *plane = geometry->plane(i);
+        for (const size_t &inlier : plane->inliers())
+        {
+            CHECK(inlier < pointCloud->size());
+        }
+        numInliersInserted += plane->inliers().size();
+        if (std::abs(plane->center().z() - 1) < 0.1f)
+        {
+            numBoxInliers = plane->inliers().size();
+        }
+    }
+    CHECK(numBoxInliers > 380);
+    CHECK(numInliersInserted - numBoxInliers > numInliersAfter + removed.size() * 9 / 10);
+
+    delete pointCloud;
+    std::cout << "incremental: ok" << std::endl;
+    return 0;
+}
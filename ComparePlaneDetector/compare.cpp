@@ -1,49 +1,56 @@
 #include <stdio.h>
 #include <vector>
-#include <set> 
-#include <map>
 #include <string>
+#include <cstring>
 #include <iostream>
 #include <cmath>
 #include <limits>
 #include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
 
-int MAX_LEVEL;
+// shared with the command line tools (PlaneComparator and the '.geo' loader), see the Makefile
+#include "planemetrics.h"
+#include "pointcloudio.hpp"
 
-struct Point
+struct Position
 {
 	float x;
 	float y;
 	float z;
-	Point (float x, float y, float z)
+	Position (float x, float y, float z)
 		: x(x)
 		, y(y)
 		, z(z)
 	{
 	}
 	
-	Point()
+	Position()
 	{
 		
 	}
 	
-	static Point Constant(float v)
+	static Position Constant(float v)
 	{
-		return Point(v, v, v);
+		return Position(v, v, v);
 	}
 };
 
-struct PointCloud 
+struct PositionCloud
 {
-	std::vector<Point> points;
+	std::vector<Position> points;
 	
 	float size() const 
 	{
-		Point min = Point::Constant(std::numeric_limits<float>::max());
-		Point max = Point::Constant(-std::numeric_limits<float>::max());
+		Position min = Position::Constant(std::numeric_limits<float>::max());
+		Position max = Position::Constant(-std::numeric_limits<float>::max());
 		for (size_t i = 0; i < points.size(); i++)
 		{
-			Point p = points[i];
+			Position p = points[i];
 			min.x = std::min(min.x, p.x);
 			min.y = std::min(min.y, p.y);
 			min.z = std::min(min.z, p.z);
@@ -55,362 +62,316 @@ struct PointCloud
 	}
 };
 
-struct Plane
-{
-	std::set<size_t> inliers;
-	float center[3];
-	float normal[3];
-};
-
-class Octree
-{
-public:
-	Octree(const PointCloud *pointCloud)
-		: mPointCloud(pointCloud)
-		, mRoot(this)
-		, mParent(NULL)
-		, mLevel(0)
-		, mLeaves(std::vector<Octree*>(pointCloud->points.size(), this))
-	{
-		Point min = Point::Constant(std::numeric_limits<float>::max());
-		Point max = Point::Constant(-std::numeric_limits<float>::max());
-		for (size_t i = 0; i < pointCloud->points.size(); i++)
-		{
-			Point p = pointCloud->points[i];
-			min.x = std::min(min.x, p.x);
-			min.y = std::min(min.y, p.y);
-			min.z = std::min(min.z, p.z);
-			max.x = std::max(max.x, p.x);
-			max.y = std::max(max.y, p.y);
-			max.z = std::max(max.z, p.z);
-			mPoints.push_back(i);
-		}
-		mCenter = Point((min.x + max.x) / 2, (min.y + max.y) / 2, (min.z + max.z) / 2);
-		mSize = std::max(max.x - min.x, std::max(max.y - min.y, max.z - min.z)) / 2;
-		for (size_t i = 0; i < 8; i++)
-		{
-			mChild[i] = NULL;
-		}
-	}
-	
-	~Octree()
-	{
-		for (size_t i = 0; i < 8; i++)
-		{
-			if (mChild[i] != NULL)
-			{
-				delete mChild[i];
-			}
-		}
-	}
-	
-	void create(float minSize)
-	{
-		//if (mSize < minSize) return; 
-		if (mPoints.empty() || mLevel > MAX_LEVEL) return;
-		float newSize = mSize / 2;
-		Point newCenters[8] = {
-			Point(mCenter.x - newSize, mCenter.y - newSize, mCenter.z - newSize),
-			Point(mCenter.x - newSize, mCenter.y - newSize, mCenter.z + newSize),
-			Point(mCenter.x - newSize, mCenter.y + newSize, mCenter.z - newSize),
-			Point(mCenter.x - newSize, mCenter.y + newSize, mCenter.z + newSize),
-			Point(mCenter.x + newSize, mCenter.y - newSize, mCenter.z - newSize),
-			Point(mCenter.x + newSize, mCenter.y - newSize, mCenter.z + newSize),
-			Point(mCenter.x + newSize, mCenter.y + newSize, mCenter.z - newSize),
-			Point(mCenter.x + newSize, mCenter.y + newSize, mCenter.z + newSize)
-		};
-		for (size_t i = 0; i < 8; i++)
-		{
-			mChild[i] = new Octree(this, newCenters[i], newSize);
-		}
-		for (const size_t &p : mPoints)
-		{
-			Point point = mPointCloud->points[p];
-			size_t index = ((point.x > mCenter.x) << 2) | ((point.y > mCenter.y) << 1) | (point.z > mCenter.z);
-			mChild[index]->mPoints.push_back(p);
-			mRoot->mLeaves[p] = mChild[index];
-		} 
-		mPoints.clear();
-		for (size_t i = 0; i < 8; i++)
-		{
-			mChild[i]->create(minSize);
-		}
-	}
-	
-	bool isLeaf() const 
-	{
-		for (size_t i = 0; i < 8; i++)
-		{
-			if (mChild[i] != NULL) return false;
-		}
-		return true;
-	}
-	
-	const Octree* findLeaf(size_t index) const 
-	{
-		return mLeaves[index];
-	}
-	
-	float size() const 
-	{
-		return mSize; 
-	}
-	
-private:
-	const PointCloud *mPointCloud;
-	Octree *mRoot;
-	Octree *mParent;
-	Octree *mChild[8];
-	std::vector<size_t> mPoints;
-	Point mCenter;
-	float mSize;
-	size_t mLevel;
-	std::vector<Octree*> mLeaves;
-	
-	Octree(Octree *parent, Point center, float size)
-		: mPointCloud(parent->mPointCloud)
-		, mRoot(parent->mRoot)
-		, mParent(parent)
-		, mCenter(center)
-		, mSize(size)
-		, mLevel(parent->mLevel + 1)
-	{
-		for (size_t i = 0; i < 8; i++)
-		{
-			mChild[i] = NULL;
-		}
-	}
-	
-};
-
-void readPointCloud(const std::string &filename, PointCloud &pointCloud) 
+bool readPointCloud(const std::string &filename, PositionCloud &pointCloud)
 {
 	FILE *fp = fopen(filename.c_str(), "rb");
 	if (fp == NULL)
 	{
 		std::cerr << "Could not open file: " << filename << std::endl;
-		getchar(); 
-		exit(-1);
+		return false;
 	}
 	size_t size, mode;
 	fread(&size, sizeof(size_t), 1, fp);
 	fread(&mode, sizeof(size_t), 1, fp);
-	for (size_t i = 0; i < size; i++) 
+	// only the positions are kept, the records are read in blocks
+	size_t recordSize = 3;
+	if (mode & 1)
+		recordSize += 3;
+	if (mode & 2)
+		recordSize += 1;
+	if (mode & 4)
+		recordSize += 3;
+	if (mode & 8)
+		recordSize += 1;
+	if (mode & 16)
+		recordSize += 1;
+	pointCloud.points.reserve(size);
+	std::vector<float> buffer;
+	for (size_t i = 0; i < size; i += 1 << 16)
 	{
-		if (i % 1000 == 0)
+		size_t count = std::min<size_t>(size - i, 1 << 16);
+		buffer.resize(count * recordSize);
+		count = fread(buffer.data(), sizeof(float) * recordSize, count, fp);
+		for (size_t j = 0; j < count; j++)
 		{
-			std::cout << i / float(size) * 100 << "..." << std::endl; 
+			const float *position = buffer.data() + j * recordSize;
+			pointCloud.points.push_back(Position(position[0], position[1], position[2]));
 		}
-		float position[3], color[3], intensity, normal[3], normalConfidence, curvature;
-		fread(position, sizeof(float), 3, fp);
-		if (mode & 1)
-			fread(color, sizeof(float), 3, fp);
-		if (mode & 2)
-			fread(&intensity, sizeof(float), 1, fp);
-		if (mode & 4)
-			fread(normal, sizeof(float), 3, fp);
-		if (mode & 8)
-			fread(&normalConfidence, sizeof(float), 1, fp);
-		if (mode & 16)
-			fread(&curvature, sizeof(float), 1, fp); 
-		Point p(position[0], position[1], position[2]);
-		pointCloud.points.push_back(p); 
+		if (count < std::min<size_t>(size - i, 1 << 16)) break;
 	}
 
 	fclose(fp);
+	return true;
 }
 
-void readPlanes(const std::string &file, Octree &octree, std::vector<Plane*> &planes)
+// The '.geo' files are read by the loader of the detection tools (PointCloudIO), which checks the counts against the
+// size of the file and the inliers against the number of points. The inliers of each plane are sorted, without
+// duplicates (legacy files may have them in any order).
+Geometry* readPlanes(const std::string &file, size_t numPoints)
 {
-	FILE *fp = fopen(file.c_str(), "rb");
-	if (fp == NULL)
+	Geometry *geometry;
+	try
+	{
+		geometry = PointCloudIO().loadGeometry(file, numPoints);
+	}
+	catch (const std::string &error)
+	{
+		std::cerr << error << " " << file << std::endl;
+		return NULL;
+	}
+	catch (const std::exception &error)
+	{
+		std::cerr << error.what() << " " << file << std::endl;
+		return NULL;
+	}
+	if (geometry == NULL)
 	{
 		std::cerr << "Could not open file " << file << std::endl;
-		exit(-1);
+		return NULL;
 	}
-	size_t numCircles;
-	fread(&numCircles, sizeof(size_t), 1, fp);
-	size_t numPlanes;
-	fread(&numPlanes, sizeof(size_t), 1, fp);
-	for (size_t i = 0; i < numPlanes; i++)
+	for (size_t i = 0; i < geometry->numPlanes(); i++)
 	{
-		Plane *plane = new Plane;
-		float color[3];
-		float basisu[3];
-		float basisv[3];
-		fread(color, sizeof(float), 3, fp);
-		fread(plane->center, sizeof(float), 3, fp);
-		fread(plane->normal, sizeof(float), 3, fp);
-		fread(basisu, sizeof(float), 3, fp);
-		fread(basisv, sizeof(float), 3, fp);
-		size_t numInliers;
-		fread(&numInliers, sizeof(size_t), 1, fp);
-		size_t *p = new size_t[numInliers];
-		fread(p, sizeof(size_t), numInliers, fp);
-		for (size_t j = 0; j < numInliers; j++)
-		{
-			plane->inliers.insert(p[j]); 
-		}
-		delete[] p;
-		planes.push_back(plane);
+		std::vector<size_t> inliers = geometry->plane(i)->inliers();
+		std::sort(inliers.begin(), inliers.end());
+		inliers.erase(std::unique(inliers.begin(), inliers.end()), inliers.end());
+		geometry->plane(i)->inliers(inliers);
 	}
-	fclose(fp);
+	return geometry;
 }
- 
-bool isPlaneEquivalent(Plane *a, Plane *b)
+
+// octree level of the metrics, fitted to the density of each dataset
+int maxLevelOf(const std::string &dataset)
 {
-	float dot = std::abs(a->normal[0] * b->normal[0] + a->normal[1] * b->normal[1] + a->normal[2] * b->normal[2]);
-	return dot > 0.86; // 30 degrees  
+	if (dataset == "box") {
+		return 12;
+	} else if (dataset == "computer") {
+		return 12;
+	} else if (dataset == "room") {
+		return 7;
+	} else if (dataset == "museum") {
+		return 12;
+	} else if (dataset == "utrecht") {
+		return 7;
+	} else if (dataset == "plant") {
+		return 9;
+	} else if (dataset == "boiler_room") {
+		return 7;
+	}
+	// other scenes, e.g. the ones written by generate_scene
+	return 9;
 }
 
-Plane* findCorrespondence(std::vector<Plane*> &groundtruth, Plane *testPlane)
+PlaneMetrics::Labels* labelsOf(size_t numPoints, const Geometry *geometry)
 {
-	std::map<Plane*, size_t> countInliers;
-	for (const size_t &inlier : testPlane->inliers)
-	{
-		bool found = false;
-		for (Plane *plane : groundtruth)
-		{
-			if (plane->inliers.find(inlier) != plane->inliers.end())
-			{
-				countInliers[plane] += 1;
-				found = true;
-				break;
-			}
-		}
-		if (!found)
-			countInliers[NULL] += 1;
-	}
-	Plane *bestPlane = NULL;
-	for (auto it = countInliers.begin(); it != countInliers.end(); ++it)
-	{
-		if (it->second > countInliers[bestPlane])
-		{
-			bestPlane = it->first;
-		}
-	} 
-	if (bestPlane == NULL || countInliers[bestPlane] < testPlane->inliers.size() / 2 || !isPlaneEquivalent(bestPlane, testPlane))
-		return NULL; 
-	return bestPlane;
+	return new PlaneMetrics::Labels(numPoints, geometry->numPlanes(), [geometry](size_t i) -> const std::vector<size_t>& { return geometry->plane(i)->inliers(); });
 }
 
-void findCorrespondences(std::vector<Plane*> &groundtruth, std::vector<Plane*> &test, std::map<Plane*, Plane*> &correspondences)
+std::vector<float> normalsOf(const Geometry *geometry)
 {
-	for (Plane *testPlane : test)
+	std::vector<float> normals;
+	for (size_t i = 0; i < geometry->numPlanes(); i++)
 	{
-		correspondences[testPlane] = findCorrespondence(groundtruth, testPlane);
+		const Eigen::Vector3f &normal = geometry->plane(i)->normal();
+		normals.insert(normals.end(), normal.data(), normal.data() + 3);
 	}
+	return normals;
 }
 
-float getPrecision(Octree &octree, std::map<Plane*, Plane*> &correspondences)
+// A dataset loaded once and the ground truth it is compared against, shared by every technique
+struct Dataset
 {
-	std::set<const Octree*> allLeaves;
-	std::set<const Octree*> correctLeaves; 
-	for (auto it = correspondences.begin(); it != correspondences.end(); ++it)
+	PositionCloud pointCloud;
+	PlaneMetrics::Leaves *leaves;
+	Geometry *groundtruth;
+	PlaneMetrics::Labels *groundtruthLabels;
+	std::vector<float> groundtruthNormals;
+	float planeRegions;
+	
+	Dataset()
+		: leaves(NULL)
+		, groundtruth(NULL)
+		, groundtruthLabels(NULL)
+		, planeRegions(0)
 	{
-		for (const size_t &inlier : it->first->inliers)
+	}
+	
+	~Dataset()
+	{
+		delete leaves;
+		delete groundtruthLabels;
+		delete groundtruth;
+	}
+	
+	bool load(const std::string &directory, const std::string &name)
+	{
+		if (!readPointCloud(directory + name + ".pcl", pointCloud)) return false;
+		leaves = new PlaneMetrics::Leaves(pointCloud.points.size(), [this](size_t i) { return &pointCloud.points[i].x; }, maxLevelOf(name));
+		groundtruth = readPlanes(directory + name + "_ground_truth.geo", pointCloud.points.size());
+		if (groundtruth == NULL) return false;
+		groundtruthLabels = labelsOf(pointCloud.points.size(), groundtruth);
+		groundtruthNormals = normalsOf(groundtruth);
+		
+		// share of the leaves with ground truth points among all the leaves (both when they have both)
+		std::vector<uint8_t> regions(leaves->numLeaves(), 0);
+		for (size_t i = 0; i < pointCloud.points.size(); i++)
 		{
-			allLeaves.insert(octree.findLeaf(inlier));
-			if (it->second != NULL && it->second->inliers.find(inlier) != it->second->inliers.end())
-			{
-				correctLeaves.insert(octree.findLeaf(inlier));
-			}
+			regions[leaves->leaf(i)] |= groundtruthLabels->empty(i) ? 2 : 1;
+		}
+		size_t numPlaneRegions = 0, numNonPlaneRegions = 0;
+		for (const uint8_t &region : regions)
+		{
+			numPlaneRegions += (region & 1) != 0;
+			numNonPlaneRegions += (region & 2) != 0;
 		}
+		planeRegions = numPlaneRegions / float(numPlaneRegions + numNonPlaneRegions);
+		return true;
 	}
-	return correctLeaves.size() / float(allLeaves.size());
-}
+};
+
+struct Evaluation
+{
+	std::string technique;
+	bool found;
+	size_t numPlanes;
+	size_t numCorrect;
+	float precision;
+	float recall;
+	float f1;
+};
 
-float getRecall(Octree &octree, std::vector<Plane*> &groundtruth, std::map<Plane*, Plane*> &correspondences)
+Evaluation evaluate(const Dataset &dataset, const std::string &testFile, const std::string &technique, size_t maxThreads)
 {
-	std::set<const Octree*> allLeaves;
-	std::set<const Octree*> correctLeaves; 
-	for (Plane *plane : groundtruth)
+	Evaluation evaluation;
+	evaluation.technique = technique;
+	evaluation.numPlanes = 0;
+	evaluation.numCorrect = 0;
+	evaluation.precision = evaluation.recall = evaluation.f1 = 0;
+	Geometry *test = readPlanes(testFile, dataset.pointCloud.points.size());
+	evaluation.found = test != NULL;
+	if (evaluation.found)
 	{
-		for (const size_t &inlier : plane->inliers)
+		PlaneMetrics::Labels *testLabels = labelsOf(dataset.pointCloud.points.size(), test);
+		std::vector<size_t> sizes;
+		for (size_t i = 0; i < test->numPlanes(); i++)
 		{
-			allLeaves.insert(octree.findLeaf(inlier));
-			for (auto it = correspondences.begin(); it != correspondences.end(); ++it)
-			{
-				if (it->second == plane && it->first->inliers.find(inlier) != it->first->inliers.end())
-				{
-					correctLeaves.insert(octree.findLeaf(inlier));
-					break;
-				}
-			}
+			sizes.push_back(test->plane(i)->inliers().size());
 		}
+		PlaneMetrics::Score score = PlaneMetrics::score(*dataset.leaves, *dataset.groundtruthLabels, *testLabels, dataset.groundtruthNormals,
+														normalsOf(test), sizes, maxThreads);
+		delete testLabels;
+		evaluation.precision = score.precision;
+		evaluation.recall = score.recall;
+		evaluation.f1 = score.f1;
+		evaluation.numCorrect = score.numCorrect;
+		evaluation.numPlanes = test->numPlanes();
 	}
-	return correctLeaves.size() / float(allLeaves.size());
+	delete test;
+	return evaluation;
 }
 
-int main(int argc, char **argv)
+// Every line of the manifest is "<directory> <dataset_name> <technique_suffix> [<technique_suffix> ...]" ('#' starts a
+// comment). Each dataset is loaded once and its techniques are evaluated concurrently, then one table is written
+// with a line per dataset and technique.
+int runBatch(const std::string &manifestFile, const std::string &outputFile)
 {
-	if (argc < 4)
+	std::ifstream manifest(manifestFile.c_str());
+	if (!manifest.good())
 	{
-		std::cerr << "Usage: compare <directory> <dataset_name> <technique_suffix>" << std::endl; 
-		exit(-1);
+		std::cerr << "Could not open file " << manifestFile << std::endl;
+		return -1;
 	}
-	if (strcmp(argv[2], "box") == 0) {
-        MAX_LEVEL = 12;
-    } else if (strcmp(argv[2], "computer") == 0) {
-        MAX_LEVEL = 12;
-    } else if (strcmp(argv[2], "room") == 0) {
-        MAX_LEVEL = 7;
-    } else if (strcmp(argv[2], "museum") == 0) {
-        MAX_LEVEL = 12;
-    } else if (strcmp(argv[2], "utrecht") == 0) {
-        MAX_LEVEL = 7;
-    } else if (strcmp(argv[2], "plant") == 0) {
-        MAX_LEVEL = 9;
-    } else if (strcmp(argv[2], "boiler_room") == 0) {
-        MAX_LEVEL = 7;
-    }
-	PointCloud pointCloud;
-	readPointCloud(std::string(argv[1]) + std::string(argv[2]) + ".pcl", pointCloud);
-	float minSize = pointCloud.size() * 0.01f;
-	Octree octree(&pointCloud);
-	octree.create(minSize);
-	std::vector<Plane*> groundtruth, test;
-	std::cout << "#Points" << pointCloud.points.size() << std::endl;
-	std::cout << "Reading planes ground truth" << std::endl;
-	readPlanes(std::string(argv[1]) + std::string(argv[2])  + "_ground_truth.geo", octree, groundtruth);
-	std::cout << "Reading planes test" << std::endl;
-	readPlanes(std::string(argv[1]) + std::string(argv[2]) + "_" + std::string(argv[3]) + ".geo", octree, test);
-	std::cout << "Done" << std::endl;
-	std::map<Plane*, Plane*> correspondences;
-	findCorrespondences(groundtruth, test, correspondences); 
-	float precision = getPrecision(octree, correspondences);
-	float recall = getRecall(octree, groundtruth, correspondences);
-	float f1 = 2 * (precision * recall) / (precision + recall);
-	std::cout << "Precision:\t\t\t" << precision << std::endl
-				<< "Recall:\t\t\t\t" << recall << std::endl
-				<< "F1-Score:\t\t\t" << f1 << std::endl;
-	std::set<Plane*> corrects;
-	for (auto it = correspondences.begin(); it != correspondences.end(); ++it)
+	std::ofstream file;
+	if (!outputFile.empty())
 	{
-		if (it->second != NULL) corrects.insert(it->second);
+		file.open(outputFile.c_str());
+		if (!file.good())
+		{
+			std::cerr << "Could not open file " << outputFile << std::endl;
+			return -1;
+		}
 	}
-	std::cout << corrects.size() << "/" << groundtruth.size() << std::endl;
-	std::set<const Octree*> planePoints, nonPlanePoints;
-	for (size_t i = 0; i < pointCloud.points.size(); i++)
+	std::ostream &output = outputFile.empty() ? std::cout : file;
+	output << "dataset,technique,planes,correct_planes,ground_truth_planes,precision,recall,f1,plane_regions" << std::endl;
+	
+	int status = 0;
+	std::string line;
+	while (std::getline(manifest, line))
 	{
-		bool isPlane = false;
-		for (const Plane *plane : groundtruth)
+		line = line.substr(0, line.find('#'));
+		std::istringstream stream(line);
+		std::string directory, name, technique;
+		std::vector<std::string> techniques;
+		if (!(stream >> directory >> name)) continue;
+		while (stream >> technique) techniques.push_back(technique);
+		
+		std::cerr << "Evaluating " << techniques.size() << " techniques on " << directory << name << std::endl;
+		Dataset dataset;
+		if (!dataset.load(directory, name))
 		{
-			if (plane->inliers.find(i) != plane->inliers.end())
+			status = -1;
+			continue;
+		}
+		size_t numCores = std::max<size_t>(1, std::thread::hardware_concurrency());
+		size_t numWorkers = std::max<size_t>(1, std::min(numCores, techniques.size()));
+		std::vector<Evaluation> evaluations(techniques.size());
+		std::atomic<size_t> next(0);
+		auto worker = [&]() {
+			for (size_t i = next++; i < techniques.size(); i = next++)
 			{
-				isPlane = true;
-				break;
+				// the cores left by the techniques are used inside each evaluation
+				evaluations[i] = evaluate(dataset, directory + name + "_" + techniques[i] + ".geo", techniques[i], std::max<size_t>(1, numCores / numWorkers));
 			}
+		};
+		std::vector<std::thread> workers;
+		for (size_t w = 1; w < numWorkers; w++)
+		{
+			workers.push_back(std::thread(worker));
 		}
-		if (isPlane)
+		worker();
+		for (std::thread &thread : workers)
 		{
-			planePoints.insert(octree.findLeaf(i));
+			thread.join();
 		}
-		else
+		for (const Evaluation &evaluation : evaluations)
 		{
-			nonPlanePoints.insert(octree.findLeaf(i));
+			if (!evaluation.found)
+			{
+				status = -1;
+				continue;
+			}
+			output << name << "," << evaluation.technique << "," << evaluation.numPlanes << "," << evaluation.numCorrect << ","
+				   << dataset.groundtruth->numPlanes() << "," << evaluation.precision << "," << evaluation.recall << "," << evaluation.f1 << ","
+				   << dataset.planeRegions << std::endl;
 		}
 	}
-	std::cout << "% plane regions = " << planePoints.size() / float(planePoints.size() + nonPlanePoints.size()) << std::endl;
+	return status;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc >= 3 && strcmp(argv[1], "--batch") == 0)
+	{
+		std::string outputFile;
+		if (argc >= 5 && strcmp(argv[3], "--output") == 0) outputFile = argv[4];
+		return runBatch(argv[2], outputFile);
+	}
+	if (argc < 4)
+	{
+		std::cerr << "Usage: compare <directory> <dataset_name> <technique_suffix>" << std::endl; 
+		std::cerr << "       compare --batch <manifest> [--output <table.csv>]" << std::endl; 
+		exit(-1);
+	}
+	Dataset dataset;
+	std::string directory(argv[1]), name(argv[2]), technique(argv[3]);
+	if (!dataset.load(directory, name)) exit(-1);
+	std::cout << "#Points" << dataset.pointCloud.points.size() << std::endl;
+	std::cout << "Reading planes test" << std::endl;
+	Evaluation evaluation = evaluate(dataset, directory + name + "_" + technique + ".geo", technique, 0);
+	if (!evaluation.found) exit(-1);
+	std::cout << "Precision:\t\t\t" << evaluation.precision << std::endl
+				<< "Recall:\t\t\t\t" << evaluation.recall << std::endl
+				<< "F1-Score:\t\t\t" << evaluation.f1 << std::endl;
+	std::cout << evaluation.numCorrect << "/" << dataset.groundtruth->numPlanes() << std::endl;
+	std::cout << "% plane regions = " << dataset.planeRegions << std::endl;
 	return 0;
 }
@@ -38,7 +38,22 @@ SOURCES += \
     collisiondetector.cpp \
     statisticsutils.cpp \
     connection.cpp \
-    extremity.cpp
+    extremity.cpp \
+    planeindex.cpp \
+    trace.cpp \
+    perfcounters.cpp \
+    memoryusage.cpp \
+    mappedpointcloud.cpp \
+    mappedfile.cpp \
+    asciiparser.cpp \
+    scangrid.cpp \
+    gridnormalestimator.cpp \
+    plyformat.cpp \
+    lasformat.cpp \
+    inliercodec.cpp \
+    scenecache.cpp \
+    parallel.cpp \
+    boundedqueue.cpp
 
 HEADERS += \
     nearestneighborcalculator.h \
@@ -67,7 +82,22 @@ HEADERS += \
     collisiondetector.h \
     statisticsutils.h \
     connection.h \
-    extremity.h
+    extremity.h \
+    planeindex.h \
+    trace.h \
+    perfcounters.h \
+    memoryusage.h \
+    mappedpointcloud.h \
+    mappedfile.h \
+    asciiparser.h \
+    scangrid.h \
+    gridnormalestimator.h \
+    plyformat.h \
+    lasformat.h \
+    inliercodec.h \
+    scenecache.h \
+    parallel.h \
+    boundedqueue.h
 unix {
     target.path = /usr/lib
     INSTALLS += target
@@ -0,0 +1 @@
+#include "asciiparser.h"
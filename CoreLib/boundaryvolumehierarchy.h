@@ -5,6 +5,7 @@
 #include <set>
 
 #include "partitioner.h"
+#include "trace.h"
 
 template <size_t DIMENSION>
 class BoundaryVolumeHierarchy : public Partitioner<DIMENSION>
@@ -46,6 +47,8 @@ public:
 
     void partition(size_t levels = 1, size_t minNumPoints = 1, float minSize = 0.0f) override
     {
+        // only the whole hierarchy is traced, not every recursive call
+        TraceScope trace(isRoot() ? "BoundaryVolumeHierarchy::partition" : NULL, "levels", levels);
         if (!isLeaf())
         {
             for (size_t i = 0; i < NUM_CHILDREN; i++)
@@ -167,6 +170,20 @@ public:
         }
     }
 
+    size_t memoryUsage() const override
+    {
+        size_t bytes = sizeof(*this) + MemoryUsage::of(mIndices) + MemoryUsage::of(mLeafTable);
+        if (!isLeaf())
+        {
+            for (size_t i = 0; i < NUM_CHILDREN; i++)
+            {
+                if (mChildren[i] != NULL)
+                    bytes += mChildren[i]->memoryUsage();
+            }
+        }
+        return bytes;
+    }
+
     Rect<DIMENSION> extension() const override
     {
         return Rect<DIMENSION>(mCenter - Vector::Constant(mSize),
@@ -0,0 +1 @@
+#include "boundedqueue.h"
@@ -9,6 +9,8 @@
 
 #include <Eigen/Core>
 
+#include "memoryusage.h"
+
 class ConnectivityGraph
 {
 public:
@@ -16,6 +18,18 @@ public:
 
     void addNode(size_t node, const std::vector<size_t> &neighbors);
 
+    /**
+     * @brief Replace all the edges at once (CSR): the neighbors of node i are neighbors[offsets[i]..offsets[i + 1]].
+     * offsets has numPoints() + 1 entries and neighbors is taken over without copying.
+     */
+    void setEdges(const std::vector<size_t> &offsets, std::vector<size_t> &&neighbors);
+
+    /**
+     * @brief Remove nodes and the edges to them, shifting the indices of the following nodes
+     * down as erasing the points from the point cloud does
+     */
+    void removeNodes(const std::vector<size_t> &nodes);
+
     std::vector<size_t> neighbors(size_t node) const
     {
         return std::vector<size_t>(mGraph.begin() + mGraphIndices[node].first, mGraph.begin() + mGraphIndices[node].first + mGraphIndices[node].second);
@@ -78,6 +92,11 @@ public:
         return mGroupInitialized;
     }
 
+    size_t memoryUsage() const
+    {
+        return MemoryUsage::of(mGraph) + MemoryUsage::of(mGraphIndices) + MemoryUsage::of(mGroupIndices) + MemoryUsage::of(mGroups);
+    }
+
 private:
     std::vector<size_t> mGraph;
     std::vector<std::pair<size_t, size_t> > mGraphIndices;
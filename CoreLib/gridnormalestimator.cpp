@@ -0,0 +1 @@
+#include "gridnormalestimator.h"
@@ -0,0 +1 @@
+#include "inliercodec.h"
@@ -0,0 +1 @@
+#include "lasformat.h"
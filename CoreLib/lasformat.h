@@ -0,0 +1,111 @@
+#ifndef LASFORMAT_H
+#define LASFORMAT_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+/**
+ * @brief Public header and point records of uncompressed LAS files (versions 1.0 to 1.4, point formats 0 to 10).
+ * LAS is little endian and the fields are read as they are, so this expects a little endian machine.
+ */
+class LASFormat
+{
+public:
+    struct Header
+    {
+        uint8_t versionMajor;
+        uint8_t versionMinor;
+        uint8_t pointFormat;
+        uint16_t recordLength;
+        uint64_t offsetToPoints;
+        uint64_t numPoints;
+        double scale[3];
+        double offset[3];
+        double min[3];
+        double max[3];
+    };
+
+    static Header readHeader(const char *data, size_t size)
+    {
+        if (size < 227 || memcmp(data, "LASF", 4) != 0)
+            throw std::string("Not a LAS file");
+        Header header;
+        header.versionMajor = load<uint8_t>(data + 24);
+        header.versionMinor = load<uint8_t>(data + 25);
+        uint8_t pointFormat = load<uint8_t>(data + 104);
+        // the two high bits flag compressed (LAZ) records
+        if (pointFormat & 0xC0)
+            throw std::string("Compressed LAS files are not supported");
+        header.pointFormat = pointFormat;
+        if (header.pointFormat > 10)
+            throw "Unknown LAS point format: " + std::to_string(header.pointFormat);
+        header.recordLength = load<uint16_t>(data + 105);
+        if (header.recordLength < recordSize(header.pointFormat))
+            throw std::string("Invalid LAS record length");
+        header.offsetToPoints = load<uint32_t>(data + 96);
+        header.numPoints = load<uint32_t>(data + 107);
+        // LAS 1.4 has a 64 bit count, the legacy one is 0 when it does not fit or for the new point formats
+        if (header.versionMajor == 1 && header.versionMinor >= 4 && size >= 255)
+            header.numPoints = load<uint64_t>(data + 247);
+        for (size_t i = 0; i < 3; i++)
+        {
+            header.scale[i] = load<double>(data + 131 + 8 * i);
+            header.offset[i] = load<double>(data + 155 + 8 * i);
+            header.max[i] = load<double>(data + 179 + 16 * i);
+            header.min[i] = load<double>(data + 187 + 16 * i);
+        }
+        return header;
+    }
+
+    /**
+     * @brief Size of the standard fields of a record (the record length can be larger, with extra bytes)
+     */
+    static size_t recordSize(uint8_t pointFormat)
+    {
+        static const size_t sizes[] = { 20, 28, 26, 34, 57, 63, 30, 36, 38, 59, 67 };
+        return sizes[pointFormat];
+    }
+
+    /**
+     * @brief Offset of the red/green/blue fields in a record, 0 if the point format has no colors
+     */
+    static size_t colorOffset(uint8_t pointFormat)
+    {
+        static const size_t offsets[] = { 0, 0, 20, 28, 0, 28, 0, 30, 30, 0, 30 };
+        return offsets[pointFormat];
+    }
+
+    inline static void position(const char *record, int32_t coordinates[3])
+    {
+        memcpy(coordinates, record, 3 * sizeof(int32_t));
+    }
+
+    inline static uint16_t intensity(const char *record)
+    {
+        return load<uint16_t>(record + 12);
+    }
+
+    inline static uint8_t classification(const char *record, uint8_t pointFormat)
+    {
+        // the legacy formats keep flags in the three high bits
+        return pointFormat < 6 ? load<uint8_t>(record + 15) & 0x1F : load<uint8_t>(record + 16);
+    }
+
+    inline static void color(const char *record, uint8_t pointFormat, uint16_t rgb[3])
+    {
+        memcpy(rgb, record + colorOffset(pointFormat), 3 * sizeof(uint16_t));
+    }
+
+private:
+    template <class T>
+    inline static T load(const char *p)
+    {
+        T value;
+        memcpy(&value, p, sizeof(T));
+        return value;
+    }
+
+};
+
+#endif // LASFORMAT_H
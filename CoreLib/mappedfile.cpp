@@ -0,0 +1 @@
+#include "mappedfile.h"
@@ -0,0 +1,109 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/**
+ * @brief Read-only memory mapping of a whole file
+ */
+class MappedFile
+{
+public:
+    MappedFile(const std::string &filename)
+        : mData(NULL)
+        , mSize(0)
+    {
+        map(filename);
+    }
+
+    ~MappedFile()
+    {
+        unmap();
+    }
+
+    MappedFile(const MappedFile&) = delete;
+
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const
+    {
+        return mData;
+    }
+
+    size_t size() const
+    {
+        return mSize;
+    }
+
+private:
+    const char *mData;
+    size_t mSize;
+    std::vector<char> mBuffer;
+
+#ifdef _WIN32
+    // no mapping here, the file is read at once instead
+    void map(const std::string &filename)
+    {
+        std::ifstream file(filename.c_str(), std::ios::binary | std::ios::ate);
+        if (!file.good())
+            throw "Could not open file: " + filename;
+        mBuffer.resize(size_t(file.tellg()));
+        file.seekg(0);
+        file.read(mBuffer.data(), mBuffer.size());
+        mData = mBuffer.data();
+        mSize = mBuffer.size();
+    }
+
+    void unmap()
+    {
+        mBuffer.clear();
+        mData = NULL;
+        mSize = 0;
+    }
+#else
+    void map(const std::string &filename)
+    {
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd == -1)
+            throw "Could not open file: " + filename;
+        struct stat status;
+        if (fstat(fd, &status) != 0)
+        {
+            close(fd);
+            throw "Could not open file: " + filename;
+        }
+        // an empty file can not be mapped, it is just an empty view
+        if (status.st_size == 0)
+        {
+            close(fd);
+            return;
+        }
+        void *data = mmap(NULL, size_t(status.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED)
+            throw "Could not map file: " + filename;
+        mData = static_cast<const char*>(data);
+        mSize = size_t(status.st_size);
+    }
+
+    void unmap()
+    {
+        if (mData != NULL) munmap(const_cast<char*>(mData), mSize);
+        mData = NULL;
+        mSize = 0;
+    }
+#endif
+
+};
+
+#endif // MAPPEDFILE_H
@@ -0,0 +1 @@
+#include "mappedpointcloud.h"
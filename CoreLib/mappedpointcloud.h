@@ -0,0 +1,192 @@
+#ifndef MAPPEDPOINTCLOUD_H
+#define MAPPEDPOINTCLOUD_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "mappedfile.h"
+
+/**
+ * @brief Read-only view of a '.pcb' file, the columnar point cloud format. The file is memory mapped and each
+ * attribute is a column used in place, without parsing or copying.
+ *
+ * Layout (native byte order): a 32 byte header (magic "PCB", uint32 version, uint64 number of points,
+ * uint64 PointCloud mode, uint32 number of sections, uint32 reserved) followed by the section table
+ * (uint32 type, uint32 reserved, uint64 offset, uint64 size for each section). Every section starts at a
+ * 64 byte aligned offset. Positions, colors and normals are 3 floats per point, the other attributes 1 float.
+ * The connectivity is stored as CSR: numPoints + 1 uint64 offsets, the uint64 neighbors and the uint64 group
+ * of each point. The geometry section uses the '.geo' layout.
+ */
+class MappedPointCloud
+{
+public:
+    enum Section
+    {
+        POSITIONS = 1,
+        COLORS = 2,
+        INTENSITIES = 3,
+        NORMALS = 4,
+        NORMAL_CONFIDENCES = 5,
+        CURVATURES = 6,
+        CONNECTIVITY_OFFSETS = 7,
+        CONNECTIVITY_NEIGHBORS = 8,
+        CONNECTIVITY_GROUPS = 9,
+        GEOMETRY = 10
+    };
+
+    static const uint32_t VERSION = 1;
+    static const size_t ALIGNMENT = 64;
+
+    struct Header
+    {
+        char magic[4];
+        uint32_t version;
+        uint64_t numPoints;
+        uint64_t mode;
+        uint32_t numSections;
+        uint32_t reserved;
+    };
+
+    struct SectionEntry
+    {
+        uint32_t type;
+        uint32_t reserved;
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    MappedPointCloud(const std::string &filename)
+        : mFile(filename)
+        , mData(mFile.data())
+        , mSize(mFile.size())
+    {
+        if (mSize < sizeof(Header))
+            throw "Not a PCB file: " + filename;
+        memcpy(&mHeader, mData, sizeof(Header));
+        if (memcmp(mHeader.magic, "PCB", 4) != 0 || mHeader.version == 0 || mHeader.version > VERSION ||
+                sizeof(Header) + mHeader.numSections * sizeof(SectionEntry) > mSize)
+            throw "Not a PCB file or unsupported version: " + filename;
+        mSections.resize(mHeader.numSections);
+        memcpy(mSections.data(), mData + sizeof(Header), mHeader.numSections * sizeof(SectionEntry));
+        for (const SectionEntry &entry : mSections)
+        {
+            if (entry.offset % ALIGNMENT != 0 || entry.offset > mSize || entry.size > mSize - entry.offset)
+                throw "Corrupted PCB file: " + filename;
+        }
+    }
+
+    MappedPointCloud(const MappedPointCloud&) = delete;
+
+    MappedPointCloud& operator=(const MappedPointCloud&) = delete;
+
+    size_t size() const
+    {
+        return mHeader.numPoints;
+    }
+
+    size_t mode() const
+    {
+        return mHeader.mode;
+    }
+
+    uint32_t version() const
+    {
+        return mHeader.version;
+    }
+
+    bool hasSection(Section type) const
+    {
+        return entry(type) != NULL;
+    }
+
+    const float* positions() const
+    {
+        return column<float>(POSITIONS, 3 * size());
+    }
+
+    const float* colors() const
+    {
+        return column<float>(COLORS, 3 * size());
+    }
+
+    const float* intensities() const
+    {
+        return column<float>(INTENSITIES, size());
+    }
+
+    const float* normals() const
+    {
+        return column<float>(NORMALS, 3 * size());
+    }
+
+    const float* normalConfidences() const
+    {
+        return column<float>(NORMAL_CONFIDENCES, size());
+    }
+
+    const float* curvatures() const
+    {
+        return column<float>(CURVATURES, size());
+    }
+
+    /**
+     * @brief The neighbors of point i are connectivityNeighbors()[offsets[i]..offsets[i + 1]]
+     */
+    const uint64_t* connectivityOffsets() const
+    {
+        return column<uint64_t>(CONNECTIVITY_OFFSETS, size() + 1);
+    }
+
+    const uint64_t* connectivityNeighbors() const
+    {
+        const uint64_t *offsets = connectivityOffsets();
+        if (offsets == NULL) return NULL;
+        return column<uint64_t>(CONNECTIVITY_NEIGHBORS, offsets[size()]);
+    }
+
+    const uint64_t* connectivityGroups() const
+    {
+        return column<uint64_t>(CONNECTIVITY_GROUPS, size());
+    }
+
+    /**
+     * @brief Offset of the geometry section in the file (0 if there is none)
+     */
+    uint64_t geometryOffset() const
+    {
+        const SectionEntry *geometry = entry(GEOMETRY);
+        return geometry != NULL ? geometry->offset : 0;
+    }
+
+private:
+    MappedFile mFile;
+    const char *mData;
+    size_t mSize;
+    Header mHeader;
+    std::vector<SectionEntry> mSections;
+
+    const SectionEntry* entry(Section type) const
+    {
+        for (const SectionEntry &entry : mSections)
+        {
+            if (entry.type == uint32_t(type)) return &entry;
+        }
+        return NULL;
+    }
+
+    template <class T>
+    const T* column(Section type, size_t count) const
+    {
+        const SectionEntry *section = entry(type);
+        if (section == NULL) return NULL;
+        if (section->size != count * sizeof(T))
+            throw "Corrupted PCB section: " + std::to_string(type);
+        return reinterpret_cast<const T*>(mData + section->offset);
+    }
+
+};
+
+#endif // MAPPEDPOINTCLOUD_H
@@ -0,0 +1 @@
+#include "memoryusage.h"
@@ -0,0 +1,52 @@
+#ifndef MEMORYUSAGE_H
+#define MEMORYUSAGE_H
+
+#include <map>
+#include <vector>
+#include <unordered_set>
+#include <unordered_map>
+
+/**
+ * @brief Heap bytes held by the standard containers, counted from their capacity. Node based containers
+ * are estimated with one node per element (the element plus two pointers) and one pointer per bucket.
+ */
+class MemoryUsage
+{
+public:
+    template <class T>
+    inline static size_t of(const std::vector<T> &vector)
+    {
+        return vector.capacity() * sizeof(T);
+    }
+
+    inline static size_t of(const std::vector<bool> &vector)
+    {
+        return vector.capacity() / 8;
+    }
+
+    template <class T>
+    inline static size_t of(const std::unordered_set<T> &set)
+    {
+        return set.size() * (sizeof(T) + 2 * sizeof(void*)) + set.bucket_count() * sizeof(void*);
+    }
+
+    template <class K, class V>
+    inline static size_t of(const std::unordered_map<K, V> &map)
+    {
+        return map.size() * (sizeof(std::pair<const K, V>) + 2 * sizeof(void*)) + map.bucket_count() * sizeof(void*);
+    }
+
+    template <class K, class T>
+    inline static size_t of(const std::map<K, std::vector<T> > &map)
+    {
+        size_t bytes = map.size() * (sizeof(std::pair<const K, std::vector<T> >) + 3 * sizeof(void*));
+        for (const std::pair<const K, std::vector<T> > &entry : map)
+        {
+            bytes += of(entry.second);
+        }
+        return bytes;
+    }
+
+};
+
+#endif // MEMORYUSAGE_H
@@ -105,6 +105,11 @@ public:
 
     virtual size_t numPoints() const = 0;
 
+    /**
+     * @brief Bytes held by this node and its descendants
+     */
+    virtual size_t memoryUsage() const = 0;
+
 private:
     const PointCloud<DIMENSION>* mPointCloud;
 
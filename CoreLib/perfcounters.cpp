@@ -0,0 +1 @@
+#include "perfcounters.h"
@@ -0,0 +1 @@
+#include "planeindex.h"
@@ -0,0 +1,181 @@
+#ifndef PLANEINDEX_H
+#define PLANEINDEX_H
+
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+
+#include "plane.h"
+#include "rect.h"
+
+/**
+ * @brief Uniform grid over the bounding boxes of plane rectangles (center +- basisU +- basisV).
+ * Each plane is registered in every cell its box overlaps, so a query only visits the planes
+ * stored in the cells it touches instead of every plane of the geometry.
+ */
+class PlaneIndex
+{
+public:
+    PlaneIndex(float cellSize)
+        : mCellSize(cellSize)
+    {
+
+    }
+
+    float cellSize() const
+    {
+        return mCellSize;
+    }
+
+    size_t size() const
+    {
+        return mPlanes.size();
+    }
+
+    const Plane* plane(size_t index) const
+    {
+        return mPlanes[index];
+    }
+
+    const Rect3d& box(size_t index) const
+    {
+        return mBoxes[index];
+    }
+
+    /**
+     * @brief Bounding box of the rectangle delimited by the plane basis
+     * @param margin
+     *      Distance by which the box is enlarged in every direction
+     */
+    static Rect3d planeBox(const Plane *plane, float margin = 0)
+    {
+        Eigen::Vector3f extent = plane->basisU().cwiseAbs() + plane->basisV().cwiseAbs() + Eigen::Vector3f::Constant(margin);
+        return Rect3d(plane->center() - extent, plane->center() + extent);
+    }
+
+    size_t add(const Plane *plane, float margin = 0)
+    {
+        size_t index = mPlanes.size();
+        Rect3d box = planeBox(plane, margin);
+        mPlanes.push_back(plane);
+        mBoxes.push_back(box);
+        int min[3], max[3];
+        cellRange(box, min, max);
+        if (numCells(min, max) > MAX_CELLS_PER_PLANE)
+        {
+            mLargePlanes.push_back(index);
+            return index;
+        }
+        for (int x = min[0]; x <= max[0]; x++)
+        {
+            for (int y = min[1]; y <= max[1]; y++)
+            {
+                for (int z = min[2]; z <= max[2]; z++)
+                {
+                    mCells[cellKey(x, y, z)].push_back(index);
+                }
+            }
+        }
+        return index;
+    }
+
+    /**
+     * @brief Find the planes whose box intersects the given box
+     * @param planes
+     *      Indices of the planes found, sorted and without duplicates
+     */
+    void query(const Rect3d &box, std::vector<size_t> &planes) const
+    {
+        planes.clear();
+        int min[3], max[3];
+        cellRange(box, min, max);
+        if (numCells(min, max) > MAX_CELLS_PER_PLANE)
+        {
+            for (size_t i = 0; i < mPlanes.size(); i++)
+            {
+                if (mBoxes[i].intersects(box)) planes.push_back(i);
+            }
+            return;
+        }
+        for (int x = min[0]; x <= max[0]; x++)
+        {
+            for (int y = min[1]; y <= max[1]; y++)
+            {
+                for (int z = min[2]; z <= max[2]; z++)
+                {
+                    auto it = mCells.find(cellKey(x, y, z));
+                    if (it == mCells.end()) continue;
+                    for (const size_t &index : it->second)
+                    {
+                        if (mBoxes[index].intersects(box)) planes.push_back(index);
+                    }
+                }
+            }
+        }
+        for (const size_t &index : mLargePlanes)
+        {
+            if (mBoxes[index].intersects(box)) planes.push_back(index);
+        }
+        std::sort(planes.begin(), planes.end());
+        planes.erase(std::unique(planes.begin(), planes.end()), planes.end());
+    }
+
+    /**
+     * @brief Find the planes whose box contains the given point
+     */
+    void query(const Eigen::Vector3f &point, std::vector<size_t> &planes) const
+    {
+        planes.clear();
+        auto it = mCells.find(cellKey(cellCoord(point(0)), cellCoord(point(1)), cellCoord(point(2))));
+        if (it != mCells.end())
+        {
+            for (const size_t &index : it->second)
+            {
+                if (mBoxes[index].containsPoint(point)) planes.push_back(index);
+            }
+        }
+        for (const size_t &index : mLargePlanes)
+        {
+            if (mBoxes[index].containsPoint(point)) planes.push_back(index);
+        }
+    }
+
+private:
+    static const size_t MAX_CELLS_PER_PLANE = 4096;
+
+    float mCellSize;
+    std::vector<const Plane*> mPlanes;
+    std::vector<Rect3d> mBoxes;
+    std::vector<size_t> mLargePlanes;
+    std::unordered_map<uint64_t, std::vector<size_t> > mCells;
+
+    inline int cellCoord(float value) const
+    {
+        return static_cast<int>(std::floor(value / mCellSize));
+    }
+
+    inline static uint64_t cellKey(int x, int y, int z)
+    {
+        const uint64_t mask = (1 << 21) - 1;
+        return ((uint64_t(x) & mask) << 42) | ((uint64_t(y) & mask) << 21) | (uint64_t(z) & mask);
+    }
+
+    inline static double numCells(const int min[3], const int max[3])
+    {
+        return (double(max[0]) - min[0] + 1) * (double(max[1]) - min[1] + 1) * (double(max[2]) - min[2] + 1);
+    }
+
+    void cellRange(const Rect3d &box, int min[3], int max[3]) const
+    {
+        for (size_t dim = 0; dim < 3; dim++)
+        {
+            min[dim] = cellCoord(box.bottomLeft()(dim));
+            max[dim] = cellCoord(box.topRight()(dim));
+        }
+    }
+
+};
+
+#endif // PLANEINDEX_H
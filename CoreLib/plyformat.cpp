@@ -0,0 +1 @@
+#include "plyformat.h"
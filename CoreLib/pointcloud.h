@@ -9,6 +9,8 @@
 #include "rect.h"
 #include "geometry.h"
 #include "connectivitygraph.h"
+#include "scangrid.h"
+#include "memoryusage.h"
 
 template <size_t DIMENSION>
 class PointCloud
@@ -113,6 +115,19 @@ public:
         return mExtension;
     }
 
+    /**
+     * @brief Bytes held by the points (the connectivity and the geometry account for themselves)
+     */
+    size_t memoryUsage() const
+    {
+        size_t bytes = MemoryUsage::of(mPoints) + MemoryUsage::of(mVisiblePoints);
+        for (const ScanGrid &scan : mScans)
+        {
+            bytes += scan.memoryUsage();
+        }
+        return bytes;
+    }
+
     void clear()
     {
         mMutex.lock();
@@ -185,6 +200,24 @@ public:
         mGeometry = geometry;
     }
 
+    /**
+     * @brief True if the point cloud was loaded from organized scans, whose grids are kept in scans()
+     */
+    bool isOrganized() const
+    {
+        return !mScans.empty();
+    }
+
+    const std::vector<ScanGrid>& scans() const
+    {
+        return mScans;
+    }
+
+    void scans(const std::vector<ScanGrid> &scans)
+    {
+        mScans = scans;
+    }
+
 protected:
     std::vector<Point<DIMENSION> > mPoints;
     std::vector<bool> mVisiblePoints;
@@ -194,6 +227,7 @@ protected:
     Rect<DIMENSION> mExtension;
     ConnectivityGraph *mConnectivity;
     Geometry *mGeometry;
+    std::vector<ScanGrid> mScans;
 
 };
 \
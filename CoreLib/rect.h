@@ -28,11 +28,21 @@ public:
         return mBottomLeft;
     }
 
+    const Vector& bottomLeft() const
+    {
+        return mBottomLeft;
+    }
+
     Vector& topRight()
     {
         return mTopRight;
     }
 
+    const Vector& topRight() const
+    {
+        return mTopRight;
+    }
+
     Vector center() const
     {
         return (mBottomLeft + mTopRight) / 2;
@@ -141,6 +151,18 @@ public:
         return true;
     }
 
+    bool intersects(const Rect &other) const
+    {
+        for (size_t dim = 0; dim < DIMENSION; dim++)
+        {
+            if (mTopRight(dim) < other.mBottomLeft(dim) || other.mTopRight(dim) < mBottomLeft(dim))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
     bool operator==(const Rect &other) const
     {
         return mBottomLeft == other.mBottomLeft &&
@@ -0,0 +1 @@
+#include "scangrid.h"
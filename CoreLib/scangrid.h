@@ -0,0 +1,79 @@
+#ifndef SCANGRID_H
+#define SCANGRID_H
+
+#include <limits>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include "memoryusage.h"
+
+/**
+ * @brief Image structure of an organized scan (e.g. a PTX scan): the point cloud index of the point seen by
+ * each cell of the scanner grid (NONE where no return was recorded), the scanner position and the transform
+ * that registered the scan.
+ */
+class ScanGrid
+{
+public:
+    static const size_t NONE = std::numeric_limits<size_t>::max();
+
+    ScanGrid(size_t width, size_t height, const Eigen::Vector3f &origin, const Eigen::Matrix4f &transform)
+        : mWidth(width)
+        , mHeight(height)
+        , mOrigin(origin)
+        , mTransform(transform)
+        , mIndices(width * height, std::numeric_limits<size_t>::max())
+    {
+
+    }
+
+    size_t width() const
+    {
+        return mWidth;
+    }
+
+    size_t height() const
+    {
+        return mHeight;
+    }
+
+    /**
+     * @brief Position of the scanner, in the coordinates of the point cloud
+     */
+    const Eigen::Vector3f& origin() const
+    {
+        return mOrigin;
+    }
+
+    Eigen::Matrix4f transform() const
+    {
+        return mTransform;
+    }
+
+    size_t at(size_t row, size_t column) const
+    {
+        return mIndices[column * mHeight + row];
+    }
+
+    void set(size_t row, size_t column, size_t index)
+    {
+        mIndices[column * mHeight + row] = index;
+    }
+
+    size_t memoryUsage() const
+    {
+        return MemoryUsage::of(mIndices);
+    }
+
+private:
+    size_t mWidth;
+    size_t mHeight;
+    Eigen::Vector3f mOrigin;
+    // unaligned, so scans can be kept in a std::vector
+    Eigen::Matrix<float, 4, 4, Eigen::DontAlign> mTransform;
+    std::vector<size_t> mIndices;
+
+};
+
+#endif // SCANGRID_H
@@ -0,0 +1 @@
+#include "scenecache.h"
@@ -6,6 +6,7 @@
 #include <iostream>
 #include <Eigen/Core>
 #include "angleutils.h"
+#include "memoryusage.h"
 
 class StatisticsUtils
 {
@@ -94,6 +95,11 @@ public:
         max = mean + range * std;
     }
 
+    size_t memoryUsage() const
+    {
+        return MemoryUsage::of(mDataBuffer) + MemoryUsage::of(mTempBuffer);
+    }
+
 private:
     std::vector<float> mDataBuffer;
     std::vector<float> mTempBuffer;
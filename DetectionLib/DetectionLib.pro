@@ -15,12 +15,20 @@ win32:QMAKE_CXXFLAGS += /bigobj
 SOURCES += \
     primitivedetector.cpp \
     planedetector.cpp \
-    planarpatch.cpp
+    planarpatch.cpp \
+    planemerger.cpp \
+    planedetectormetrics.cpp \
+    planecomparator.cpp \
+    planemetrics.cpp
 
 HEADERS += \
     primitivedetector.h \
     planedetector.h \
-    planarpatch.h
+    planarpatch.h \
+    planemerger.h \
+    planedetectormetrics.h \
+    planecomparator.h \
+    planemetrics.h
 unix {
     target.path = /usr/lib
     INSTALLS += target
@@ -0,0 +1 @@
+#include "planecomparator.h"
@@ -3,24 +3,70 @@
 #include "pcacalculator.h"
 #include "unionfind.h"
 #include "angleutils.h"
+#include "planeindex.h"
 
 #include <iostream>
 #include <unordered_map>
-#include <QElapsedTimer>
+#include <unordered_set>
 
 PlaneDetector::PlaneDetector(const PointCloud3d *pointCloud)
     : PrimitiveDetector<3, Plane>(pointCloud)
     , mMinNormalDiff(std::cos(AngleUtils::deg2rad(60.0f)))
     , mMaxDist(std::cos(AngleUtils::deg2rad(75.0f)))
     , mOutlierRatio(0.75f)
+    , mNumSeedPoints(0)
+    , mKeepState(false)
+    , mStatistics(NULL)
+    , mMinNumPoints(0)
+    , mDeadline(std::chrono::steady_clock::time_point::max())
+    , mExpired(false)
+    , mPrintMetrics(false)
+    , mGeometryBytes(0)
 {
 
 }
 
+PlaneDetector::~PlaneDetector()
+{
+    clearState();
+}
+
 std::set<Plane*> PlaneDetector::detect()
 {
-    std::set<Plane*> planes;
+    return detect(NULL);
+}
 
+std::set<Plane*> PlaneDetector::detect(const Geometry *seed)
+{
+    mDeadline = std::chrono::steady_clock::time_point::max();
+    std::vector<Plane*> planes = detectPlanes(seed);
+    return std::set<Plane*>(planes.begin(), planes.end());
+}
+
+std::vector<Plane*> PlaneDetector::detect(std::vector<int32_t> &labels, const Geometry *seed)
+{
+    mDeadline = std::chrono::steady_clock::time_point::max();
+    return detectPlanes(seed, &labels);
+}
+
+std::set<Plane*> PlaneDetector::detect(std::chrono::steady_clock::time_point deadline, bool &converged)
+{
+    mDeadline = deadline;
+    std::vector<Plane*> planes = detectPlanes(NULL);
+    converged = !mExpired;
+    mDeadline = std::chrono::steady_clock::time_point::max();
+    mExpired = false;
+    return std::set<Plane*>(planes.begin(), planes.end());
+}
+
+std::vector<Plane*> PlaneDetector::detectPlanes(const Geometry *seed, std::vector<int32_t> *labels)
+{
+    TraceScope trace("PlaneDetector::detect", "points", pointCloud()->size());
+    std::vector<Plane*> planes;
+    mExpired = false;
+    mPublishedPatches.clear();
+
+    clearState();
     clearRemovedPoints();
     for (size_t i = 0; i < pointCloud()->geometry()->numPlanes(); i++)
     {
@@ -30,96 +76,237 @@ std::set<Plane*> PlaneDetector::detect()
         }
     }
 
-    std::cout << mMinNormalDiff << " " << mMaxDist << " " << mOutlierRatio << std::endl;
-
-    float timeDetectPatches = 0;
-    float timeMerge = 0;
-    float timeGrowth = 0;
-    float timeRelaxedGrowth = 0;
-    float timeUpdate = 0;
-    float timeDelimit = 0;
-
-    QElapsedTimer timer;
-    timer.start();
+    mMetrics.clear();
+    // the geometry is not read again while detecting, planes may be added to it from other threads
+    mGeometryBytes = mMetrics.measureMemory() ? pointCloud()->geometry()->memoryUsage() : 0;
     size_t minNumPoints = std::max(size_t(10), size_t(pointCloud()->size() * 0.001f));
-    StatisticsUtils statistics(pointCloud()->size());
+    StatisticsUtils *statistics = new StatisticsUtils(pointCloud()->size());
     Octree octree(pointCloud());
     std::vector<PlanarPatch*> patches;
-    detectPlanarPatches(&octree, &statistics, minNumPoints, patches);
-    timeDetectPatches += timer.nsecsElapsed() / 1e9;
-
     mPatchPoints = std::vector<PlanarPatch*>(pointCloud()->size(), NULL);
-    for (PlanarPatch *patch : patches)
+    mNumSeedPoints = 0;
+    size_t numSeedPatches;
     {
-        for (const size_t &point : patch->points())
+        PlaneDetectorMetrics::Timer timer(mMetrics, PlaneDetectorMetrics::DETECT_PATCHES);
+        if (seed != NULL)
         {
-            mPatchPoints[point] = patch;
+            seedPatches(seed, statistics, minNumPoints, patches);
+        }
+        numSeedPatches = patches.size();
+        detectPlanarPatches(&octree, statistics, minNumPoints, patches);
+    }
+    sampleMemory(PlaneDetectorMetrics::DETECT_PATCHES, octree, patches, statistics);
+
+    for (size_t i = numSeedPatches; i < patches.size(); i++)
+    {
+        for (const size_t &point : patches[i]->points())
+        {
+            mPatchPoints[point] = patches[i];
         }
     }
+    mMetrics.numInitialPatches(patches.size());
 
-    std::cout << "#" << patches.size() << std::endl;
+    // an expired deadline still lets the first merge run, the unmerged patches are only fragments of planes
+    bool merged = false;
     bool changed;
     do
     {
-        timer.start();
-        growPatches(patches);
-        timeGrowth += timer.nsecsElapsed() / 1e9;
+        {
+            PlaneDetectorMetrics::Timer timer(mMetrics, PlaneDetectorMetrics::GROW);
+            growPatches(patches);
+        }
+        sampleMemory(PlaneDetectorMetrics::GROW, octree, patches, statistics);
+        if (merged && isExpired()) break;
 
-        timer.start();
-        mergePatches(patches);
-        timeMerge += timer.nsecsElapsed() / 1e9;
-        std::cout << "#" << patches.size() << std::endl;
+        {
+            PlaneDetectorMetrics::Timer timer(mMetrics, PlaneDetectorMetrics::MERGE);
+            mergePatches(patches);
+        }
+        sampleMemory(PlaneDetectorMetrics::MERGE, octree, patches, statistics);
+        merged = true;
+        mMetrics.addIteration(patches.size());
+        if (isExpired()) break;
 
-        timer.start();
-        changed = updatePatches(patches);
-        timeUpdate += timer.nsecsElapsed() / 1e9;
+        {
+            PlaneDetectorMetrics::Timer timer(mMetrics, PlaneDetectorMetrics::UPDATE);
+            changed = updatePatches(patches);
+        }
+        sampleMemory(PlaneDetectorMetrics::UPDATE, octree, patches, statistics);
+        publishFinalPatches(patches);
     } while (changed);
 
-    timer.start();
-    growPatches(patches, true);
-    timeRelaxedGrowth += timer.nsecsElapsed() / 1e9;
+    {
+        PlaneDetectorMetrics::Timer timer(mMetrics, PlaneDetectorMetrics::RELAXED_GROW);
+        growPatches(patches, true);
+    }
+    sampleMemory(PlaneDetectorMetrics::RELAXED_GROW, octree, patches, statistics);
+
+    {
+        PlaneDetectorMetrics::Timer timer(mMetrics, PlaneDetectorMetrics::DELIMIT);
+        std::vector<PlanarPatch*> truePositivePatches;
+        for (PlanarPatch *patch : patches)
+        {
+            if (mPublishedPatches.find(patch) != mPublishedPatches.end())
+            {
+                truePositivePatches.push_back(patch);
+                continue;
+            }
+            delimitPlane(patch);
+            mMetrics.addPointsProcessed(PlaneDetectorMetrics::DELIMIT, patch->points().size());
+            if (isFalsePositive(patch))
+            {
+                for (const size_t &point : patch->points())
+                {
+                    mPatchPoints[point] = NULL;
+                }
+                delete patch;
+            }
+            else
+            {
+                truePositivePatches.push_back(patch);
+                publishPatch(patch);
+            }
+        }
+        patches = truePositivePatches;
+        mPublishedPatches.clear();
+    }
+    sampleMemory(PlaneDetectorMetrics::DELIMIT, octree, patches, statistics);
 
-    timer.start();
-    std::vector<PlanarPatch*> truePositivePatches;
+    if (labels != NULL)
+    {
+        labels->assign(pointCloud()->size(), -1);
+    }
     for (PlanarPatch *patch : patches)
     {
-        delimitPlane(patch);
-        if (isFalsePositive(patch))
+        Plane *plane = new Plane(patch->plane());
+        if (labels != NULL)
         {
-            delete patch;
+            for (const size_t &point : patch->points())
+            {
+                (*labels)[point] = int32_t(planes.size());
+            }
+        }
+        // the kept state needs the inliers of the planes
+        if (labels == NULL || mKeepState)
+        {
+            plane->inliers(patch->points());
+        }
+        planes.push_back(plane);
+        if (mKeepState)
+        {
+            mPatches.push_back(patch);
+            mPlanes.push_back(plane);
         }
         else
         {
-            truePositivePatches.push_back(patch);
+            delete patch;
         }
     }
-    patches = truePositivePatches;
-    std::cout << "#" << patches.size() << std::endl;
-    timeDelimit += timer.nsecsElapsed() / 1e9;
-
-    for (PlanarPatch *patch : patches)
+    mMetrics.addAllocations(patches.size());
+    mMetrics.numPlanes(planes.size());
+    if (mKeepState)
     {
-        Plane *plane = new Plane(patch->plane());
-        plane->inliers(patch->points());
-        planes.insert(plane);
-        delete patch;
+        mStatistics = statistics;
+        mMinNumPoints = minNumPoints;
+    }
+    else
+    {
+        delete statistics;
     }
 
-    std::cout << "#" << patches.size() << std::endl;
-    std::cout << "Detect planar patches - Time elapsed: " << timeDetectPatches << "s" <<  std::endl;
-    std::cout << "Merge patches - Time elapsed: " << timeMerge << "s" <<  std::endl;
-    std::cout << "Grow patches - Time elapsed: " << timeGrowth << "s" <<  std::endl;
-    std::cout << "Relaxed Grow patches - Time elapsed: " << timeRelaxedGrowth << "s" <<  std::endl;
-    std::cout << "Update - Time elapsed: " << timeUpdate << "s" <<  std::endl;
-    std::cout << "Total time elapsed: " << timeDetectPatches + timeMerge + timeGrowth + timeRelaxedGrowth + timeUpdate << "s" << std::endl;
-    std::cout << "Delimit planes - Time elapsed: " << timeDelimit << "s" <<  std::endl;
+    if (mPrintMetrics)
+    {
+        mMetrics.print(std::cout);
+    }
 
     return planes;
 }
 
+void PlaneDetector::seedPatches(const Geometry *seed, StatisticsUtils *statistics, size_t minNumPoints, std::vector<PlanarPatch*> &patches)
+{
+    if (seed->numPlanes() == 0) return;
+    // loose tolerance for the first assignment, the robust fit of each patch trims it afterwards
+    float maxDist = pointCloud()->extension().maxSize() * 0.01f;
+    float cellSize = 0;
+    for (size_t i = 0; i < seed->numPlanes(); i++)
+    {
+        const Plane *plane = seed->plane(i);
+        cellSize += 2 * (plane->basisU().norm() + plane->basisV().norm());
+    }
+    PlaneIndex index(std::max(cellSize / seed->numPlanes(), std::max(maxDist, std::numeric_limits<float>::epsilon())));
+    for (size_t i = 0; i < seed->numPlanes(); i++)
+    {
+        index.add(seed->plane(i), maxDist);
+    }
+
+    std::vector<std::vector<size_t> > candidates(seed->numPlanes());
+    std::vector<size_t> planes;
+    for (size_t point = 0; point < pointCloud()->size(); point++)
+    {
+        if (isRemoved(point)) continue;
+        const Eigen::Vector3f &position = pointCloud()->at(point).position();
+        index.query(position, planes);
+        size_t closestPlane = seed->numPlanes();
+        float closestDist = maxDist;
+        for (const size_t &i : planes)
+        {
+            float dist = std::abs(index.plane(i)->getSignedDistanceFromSurface(position));
+            if (dist < closestDist)
+            {
+                closestDist = dist;
+                closestPlane = i;
+            }
+        }
+        if (closestPlane < seed->numPlanes())
+        {
+            candidates[closestPlane].push_back(point);
+        }
+    }
+
+    for (const std::vector<size_t> &points : candidates)
+    {
+        if (points.size() < minNumPoints) continue;
+        PlanarPatch *patch = new PlanarPatch(pointCloud(), statistics, points, mMinNormalDiff, mMaxDist, mOutlierRatio);
+        mMetrics.addAllocations(1);
+        mMetrics.addPointsProcessed(PlaneDetectorMetrics::DETECT_PATCHES, points.size());
+        if (!patch->isPlanar())
+        {
+            delete patch;
+            continue;
+        }
+        patch->update();
+        // the points lying on the refitted plane whose normals disagree (e.g. along its edges)
+        // stay with it, as they would after a relaxed growth
+        std::vector<size_t> inliers;
+        for (const size_t &point : points)
+        {
+            if (std::abs(patch->plane().getSignedDistanceFromSurface(pointCloud()->at(point).position())) < patch->maxDistPlane())
+            {
+                inliers.push_back(point);
+                mPatchPoints[point] = patch;
+            }
+        }
+        patch->points(inliers);
+        mNumSeedPoints += inliers.size();
+        patches.push_back(patch);
+    }
+}
+
+size_t PlaneDetector::numFreePoints(const std::vector<size_t> &points) const
+{
+    size_t numFreePoints = 0;
+    for (const size_t &point : points)
+    {
+        numFreePoints += mPatchPoints[point] == NULL && !isRemoved(point);
+    }
+    return numFreePoints;
+}
+
 bool PlaneDetector::detectPlanarPatches(Octree *node, StatisticsUtils *statistics, size_t minNumPoints, std::vector<PlanarPatch*> &patches)
 {
-    if (node->numPoints() < minNumPoints) return false;
+    if (node->numPoints() < minNumPoints || isExpired()) return false;
+    // regions already explained by the seed planes are not searched again
+    if (mNumSeedPoints > 0 && node->isLeaf() && numFreePoints(node->points()) < minNumPoints) return false;
     node->partition(1, minNumPoints);
     bool hasPlanarPatch = false;
     for (size_t i = 0; i < 8; i++)
@@ -131,7 +318,19 @@ bool PlaneDetector::detectPlanarPatches(Octree *node, StatisticsUtils *statistic
     }
     if (!hasPlanarPatch && node->octreeLevel() > 2)
     {
-        PlanarPatch *patch = new PlanarPatch(pointCloud(), statistics, node->points(), mMinNormalDiff, mMaxDist, mOutlierRatio);
+        std::vector<size_t> points = node->points();
+        if (mNumSeedPoints > 0)
+        {
+            size_t numPoints = points.size();
+            points.erase(std::remove_if(points.begin(), points.end(), [this](const size_t &point) {
+                return mPatchPoints[point] != NULL || isRemoved(point);
+            }), points.end());
+            // the leftovers of a mostly explained region (e.g. the points along an edge) are not a new plane
+            if (points.size() < minNumPoints || points.size() * 2 < numPoints) return false;
+        }
+        PlanarPatch *patch = new PlanarPatch(pointCloud(), statistics, points, mMinNormalDiff, mMaxDist, mOutlierRatio);
+        mMetrics.addAllocations(1);
+        mMetrics.addPointsProcessed(PlaneDetectorMetrics::DETECT_PATCHES, points.size());
         if (patch->isPlanar())
         {
             patches.push_back(patch);
@@ -148,11 +347,14 @@ bool PlaneDetector::detectPlanarPatches(Octree *node, StatisticsUtils *statistic
 void PlaneDetector::growPatches(std::vector<PlanarPatch*> &patches, bool relaxed)
 {
     std::sort(patches.begin(), patches.end(), [](const PlanarPatch *a, const PlanarPatch *b) {
-       return a->minNormalDiff() > b->minNormalDiff();
+       return a->minNormalDiff() > b->minNormalDiff() ||
+               (a->minNormalDiff() == b->minNormalDiff() && a->points().size() > b->points().size());
     });
     std::queue<size_t> queue;
+    size_t numPointsProcessed = 0;
     for (PlanarPatch *patch : patches)
     {
+        if (isExpired()) break;
         if (patch->stable()) continue;
         for (const size_t &point : patch->points())
         {
@@ -162,6 +364,7 @@ void PlaneDetector::growPatches(std::vector<PlanarPatch*> &patches, bool relaxed
         {
             size_t point = queue.front();
             queue.pop();
+            ++numPointsProcessed;
             std::pair<std::vector<size_t>::const_iterator, std::vector<size_t>::const_iterator> neighborsIterators = pointCloud()->connectivity()->neighborsIterator(point);
             for (std::vector<size_t>::const_iterator neighborsIterator = neighborsIterators.first; neighborsIterator != neighborsIterators.second; ++neighborsIterator)
             {
@@ -180,6 +383,7 @@ void PlaneDetector::growPatches(std::vector<PlanarPatch*> &patches, bool relaxed
             }
         }
     }
+    mMetrics.addPointsProcessed(relaxed ? PlaneDetectorMetrics::RELAXED_GROW : PlaneDetectorMetrics::GROW, numPointsProcessed);
 }
 
 
@@ -192,6 +396,7 @@ void PlaneDetector::mergePatches(std::vector<PlanarPatch*> &patches)
     }
     std::vector<bool> graph(n * n, false);
     std::vector<bool> disconnectedPatches(n * n, false);
+    mMetrics.addTransientMemory(PlaneDetectorMetrics::DETECTOR, MemoryUsage::of(graph) + MemoryUsage::of(disconnectedPatches));
     for (size_t i = 0; i < patches.size(); i++)
     {
         for (size_t j = i + 1; j < patches.size(); j++)
@@ -203,6 +408,7 @@ void PlaneDetector::mergePatches(std::vector<PlanarPatch*> &patches)
     }
     for (PlanarPatch *p : patches)
     {
+        mMetrics.addPointsProcessed(PlaneDetectorMetrics::MERGE, p->points().size());
         for (const size_t &point : p->points())
         {
             std::pair<std::vector<size_t>::const_iterator, std::vector<size_t>::const_iterator> neighborsIterators = pointCloud()->connectivity()->neighborsIterator(point);
@@ -258,6 +464,7 @@ void PlaneDetector::mergePatches(std::vector<PlanarPatch*> &patches)
             }
             patches[root]->maxDistPlane(std::max(patches[root]->maxDistPlane(), patches[i]->maxDistPlane()));
             patches[root]->minNormalDiff(std::min(patches[root]->minNormalDiff(), patches[i]->minNormalDiff()));
+            patches[root]->numMerges()++;
             delete patches[i];
             patches[i] = NULL;
         }
@@ -274,6 +481,7 @@ bool PlaneDetector::updatePatches(std::vector<PlanarPatch*> &patches)
     {
         if (patch->numNewPoints() > (patch->points().size() - patch->numNewPoints()) / 2)
         {
+            mMetrics.addPointsProcessed(PlaneDetectorMetrics::UPDATE, patch->points().size());
             patch->updatePlane();
             patch->stable() = false;
             changed = true;
@@ -286,6 +494,86 @@ bool PlaneDetector::updatePatches(std::vector<PlanarPatch*> &patches)
     return changed;
 }
 
+void PlaneDetector::publishFinalPatches(std::vector<PlanarPatch*> &patches)
+{
+    if (!mPlaneCallback) return;
+    // a stable patch only changes again if it merges, which needs another patch to reach it through
+    // a free point or to change next to it, so the stable patches surrounded by stable patches are final
+    size_t n = patches.size();
+    for (size_t i = 0; i < n; i++)
+    {
+        patches[i]->index(i);
+    }
+    std::vector<bool> final(n, false);
+    std::vector<std::pair<size_t, size_t> > adjacentPatches;
+    // marks the neighbors of the current patch, only the entries it set are cleared for the next one
+    std::vector<bool> adjacent(n, false);
+    for (size_t i = 0; i < n; i++)
+    {
+        PlanarPatch *patch = patches[i];
+        if (!patch->stable()) continue;
+        final[i] = true;
+        if (mPublishedPatches.find(patch) != mPublishedPatches.end()) continue;
+        size_t firstAdjacent = adjacentPatches.size();
+        for (const size_t &point : patch->points())
+        {
+            std::pair<std::vector<size_t>::const_iterator, std::vector<size_t>::const_iterator> neighborsIterators = pointCloud()->connectivity()->neighborsIterator(point);
+            for (std::vector<size_t>::const_iterator neighborsIterator = neighborsIterators.first; neighborsIterator != neighborsIterators.second; ++neighborsIterator)
+            {
+                PlanarPatch *np = mPatchPoints[*neighborsIterator];
+                if (np == NULL && !isRemoved(*neighborsIterator))
+                {
+                    final[i] = false;
+                    break;
+                }
+                if (np != NULL && np != patch && !adjacent[np->index()])
+                {
+                    adjacent[np->index()] = true;
+                    adjacentPatches.push_back(std::make_pair(i, np->index()));
+                }
+            }
+            if (!final[i]) break;
+        }
+        for (size_t j = firstAdjacent; j < adjacentPatches.size(); j++)
+        {
+            adjacent[adjacentPatches[j].second] = false;
+        }
+    }
+    bool changed;
+    do
+    {
+        changed = false;
+        for (const std::pair<size_t, size_t> &adjacentPatch : adjacentPatches)
+        {
+            if (final[adjacentPatch.first] && !final[adjacentPatch.second])
+            {
+                final[adjacentPatch.first] = false;
+                changed = true;
+            }
+        }
+    } while (changed);
+    for (size_t i = 0; i < n; i++)
+    {
+        PlanarPatch *patch = patches[i];
+        if (!final[i] || mPublishedPatches.find(patch) != mPublishedPatches.end()) continue;
+        delimitPlane(patch);
+        // false positives stay among the patches, so their points are not grown into by the others
+        if (!isFalsePositive(patch))
+        {
+            publishPatch(patch);
+        }
+    }
+}
+
+void PlaneDetector::publishPatch(const PlanarPatch *patch)
+{
+    if (!mPlaneCallback) return;
+    mPublishedPatches.insert(patch);
+    Plane plane(patch->plane());
+    plane.inliers(patch->points());
+    mPlaneCallback(plane);
+}
+
 void PlaneDetector::getPlaneOutlier(const PlanarPatch *patch, std::vector<size_t> &outlier)
 {
     Eigen::Vector3f basisU, basisV;
@@ -363,15 +651,18 @@ void PlaneDetector::delimitPlane(Plane *plane)
 
 bool PlaneDetector::isFalsePositive(PlanarPatch *patch)
 {
-    return patch->numUpdates() == 0 ||
-            patch->getSize() / float(pointCloud()->extension().maxSize()) < 0.01f;
+    // a patch that was never refitted after growing is a fragment. When the deadline interrupted the
+    // detection, a patch merged with others counts as well, since the update that refits it may not have run
+    bool consistent = patch->numUpdates() > 0 || (mExpired && patch->numMerges() > 0);
+    return !consistent || patch->getSize() / float(pointCloud()->extension().maxSize()) < 0.01f;
 }
 
 Plane* PlaneDetector::detectPlane(const std::vector<size_t> &points)
 {
     StatisticsUtils statistics(pointCloud()->size());
     PlanarPatch placeholder(pointCloud(), &statistics, points, mMinNormalDiff, mMaxDist, mOutlierRatio);
-    mPatchPoints = std::vector<PlanarPatch*>(pointCloud()->size(), NULL);
+    std::vector<PlanarPatch*> statePatchPoints(pointCloud()->size(), NULL);
+    statePatchPoints.swap(mPatchPoints);
     for (size_t i = 0; i < pointCloud()->geometry()->numPlanes(); i++)
     {
         const Plane *plane = pointCloud()->geometry()->plane(i);
@@ -393,6 +684,7 @@ Plane* PlaneDetector::detectPlane(const std::vector<size_t> &points)
     delimitPlane(&patch);
     Plane *plane = new Plane(patch.plane());
     plane->inliers(newPoints);
+    mPatchPoints.swap(statePatchPoints);
     return plane;
 }
 
@@ -400,7 +692,8 @@ void PlaneDetector::growRegion(std::vector<size_t> &points)
 {
     StatisticsUtils statistics(pointCloud()->size());
     PlanarPatch placeholder(pointCloud(), &statistics, points, mMinNormalDiff, mMaxDist, mOutlierRatio);
-    mPatchPoints = std::vector<PlanarPatch*>(pointCloud()->size(), NULL);
+    std::vector<PlanarPatch*> statePatchPoints(pointCloud()->size(), NULL);
+    statePatchPoints.swap(mPatchPoints);
     for (size_t i = 0; i < pointCloud()->geometry()->numPlanes(); i++)
     {
         const Plane *plane = pointCloud()->geometry()->plane(i);
@@ -423,4 +716,379 @@ void PlaneDetector::growRegion(std::vector<size_t> &points)
     growPatches(patches);
     points = patch->points();
     delete patch;
+    mPatchPoints.swap(statePatchPoints);
+}
+
+bool PlaneDetector::hasState(const Geometry *geometry) const
+{
+    if (!hasState()) return false;
+    std::unordered_set<const Plane*> geometryPlanes;
+    for (size_t i = 0; i < geometry->numPlanes(); i++)
+    {
+        geometryPlanes.insert(geometry->plane(i));
+    }
+    for (size_t i = 0; i < mPatches.size(); i++)
+    {
+        if (geometryPlanes.find(mPlanes[i]) == geometryPlanes.end() ||
+                mPlanes[i]->inliers().size() != mPatches[i]->points().size()) return false;
+    }
+    return mPatchPoints.size() == pointCloud()->size();
+}
+
+void PlaneDetector::clearState()
+{
+    for (PlanarPatch *patch : mPatches)
+    {
+        delete patch;
+    }
+    mPatches.clear();
+    mPlanes.clear();
+    delete mStatistics;
+    mStatistics = NULL;
+}
+
+void PlaneDetector::detachPoints(Geometry *geometry, const std::vector<size_t> &points)
+{
+    if (!hasState()) throw "There is no detection to update.";
+    for (size_t i = 0; i < mPatches.size(); i++)
+    {
+        mPatches[i]->index(i);
+    }
+    std::vector<bool> affected(mPatches.size(), false);
+    for (const size_t &point : points)
+    {
+        removePoint(point);
+        if (mPatchPoints[point] != NULL)
+        {
+            affected[mPatchPoints[point]->index()] = true;
+            mPatchPoints[point] = NULL;
+        }
+    }
+    for (size_t i = 0; i < mPatches.size(); i++)
+    {
+        if (!affected[i]) continue;
+        PlanarPatch *patch = mPatches[i];
+        std::vector<size_t> patchPoints = patch->points();
+        patchPoints.erase(std::remove_if(patchPoints.begin(), patchPoints.end(), [this, patch](const size_t &point) {
+            return mPatchPoints[point] != patch;
+        }), patchPoints.end());
+        patch->points(patchPoints);
+    }
+    excludeUnknownPlanes(geometry);
+    refitPatches(geometry, affected);
+}
+
+void PlaneDetector::erasePoints(Geometry *geometry, const std::vector<size_t> &points)
+{
+    if (!hasState()) throw "There is no detection to update.";
+    size_t oldSize = mPatchPoints.size();
+    if (pointCloud()->size() + points.size() != oldSize) throw "The point cloud does not match the detection to update.";
+    for (size_t i = 0; i < mPatches.size(); i++)
+    {
+        mPatches[i]->index(i);
+    }
+
+    const size_t erased = std::numeric_limits<size_t>::max();
+    std::vector<size_t> newIndices(oldSize, 0);
+    std::vector<bool> affected(mPatches.size(), false);
+    for (const size_t &point : points)
+    {
+        newIndices[point] = erased;
+        if (mPatchPoints[point] != NULL)
+        {
+            affected[mPatchPoints[point]->index()] = true;
+        }
+    }
+    std::vector<size_t> removedPoints;
+    size_t numPoints = 0;
+    for (size_t i = 0; i < oldSize; i++)
+    {
+        if (newIndices[i] == erased) continue;
+        newIndices[i] = numPoints++;
+        if (isRemoved(i))
+        {
+            removedPoints.push_back(newIndices[i]);
+        }
+    }
+    clearRemovedPoints();
+    for (const size_t &point : removedPoints)
+    {
+        removePoint(point);
+    }
+
+    // the indices shift, so every inlier list is remapped (but only the planes that lost points are refitted)
+    std::unordered_set<const Plane*> statePlanes(mPlanes.begin(), mPlanes.end());
+    for (size_t i = 0; i < geometry->numPlanes(); i++)
+    {
+        Plane *plane = geometry->plane(i);
+        if (statePlanes.find(plane) != statePlanes.end()) continue;
+        std::vector<size_t> inliers;
+        for (const size_t &inlier : plane->inliers())
+        {
+            if (newIndices[inlier] != erased)
+            {
+                inliers.push_back(newIndices[inlier]);
+            }
+        }
+        if (inliers.size() < plane->inliers().size())
+        {
+            plane->inliers(inliers);
+            if (!inliers.empty()) delimitPlane(plane);
+        }
+        else
+        {
+            plane->inliers(inliers);
+        }
+    }
+    mPatchPoints = std::vector<PlanarPatch*>(pointCloud()->size(), NULL);
+    for (size_t i = 0; i < mPatches.size(); i++)
+    {
+        PlanarPatch *patch = mPatches[i];
+        std::vector<size_t> patchPoints;
+        patchPoints.reserve(patch->points().size());
+        for (const size_t &point : patch->points())
+        {
+            if (newIndices[point] != erased)
+            {
+                patchPoints.push_back(newIndices[point]);
+                mPatchPoints[newIndices[point]] = patch;
+            }
+        }
+        patch->points(patchPoints);
+        mPlanes[i]->inliers(patchPoints);
+    }
+    excludeUnknownPlanes(geometry);
+    refitPatches(geometry, affected);
+}
+
+void PlaneDetector::insertPoints(Geometry *geometry, const std::vector<size_t> &points)
+{
+    if (!hasState()) throw "There is no detection to update.";
+    size_t oldSize = mPatchPoints.size();
+    if (oldSize + points.size() != pointCloud()->size()) throw "The point cloud does not match the detection to update.";
+    for (const size_t &point : points)
+    {
+        if (point < oldSize || point >= pointCloud()->size()) throw "The inserted points must be at the end of the point cloud.";
+    }
+    std::vector<size_t> removedPoints;
+    for (size_t i = 0; i < oldSize; i++)
+    {
+        if (isRemoved(i))
+        {
+            removedPoints.push_back(i);
+        }
+    }
+    clearRemovedPoints();
+    for (const size_t &point : removedPoints)
+    {
+        removePoint(point);
+    }
+    mPatchPoints.resize(pointCloud()->size(), NULL);
+    excludeUnknownPlanes(geometry);
+
+    for (size_t i = 0; i < mPatches.size(); i++)
+    {
+        mPatches[i]->index(i);
+    }
+    std::vector<bool> affected(mPatches.size(), false);
+    for (const size_t &point : points)
+    {
+        std::pair<std::vector<size_t>::const_iterator, std::vector<size_t>::const_iterator> neighborsIterators = pointCloud()->connectivity()->neighborsIterator(point);
+        for (std::vector<size_t>::const_iterator neighborsIterator = neighborsIterators.first; neighborsIterator != neighborsIterators.second; ++neighborsIterator)
+        {
+            if (mPatchPoints[*neighborsIterator] != NULL)
+            {
+                affected[mPatchPoints[*neighborsIterator]->index()] = true;
+            }
+        }
+    }
+    refitPatches(geometry, affected);
+
+    std::vector<size_t> freePoints;
+    for (const size_t &point : points)
+    {
+        if (mPatchPoints[point] == NULL && !isRemoved(point))
+        {
+            freePoints.push_back(point);
+        }
+    }
+    if (freePoints.size() >= mMinNumPoints)
+    {
+        detectLocally(geometry, freePoints);
+    }
+}
+
+void PlaneDetector::detectLocally(Geometry *geometry, const std::vector<size_t> &points)
+{
+    // every other point is removed while detecting, so the new patches only search, grow and merge among these
+    std::vector<bool> removed(pointCloud()->size(), true);
+    for (const size_t &point : points)
+    {
+        removed[point] = false;
+    }
+    std::vector<size_t> removedPoints;
+    for (size_t i = 0; i < pointCloud()->size(); i++)
+    {
+        if (isRemoved(i))
+        {
+            removedPoints.push_back(i);
+        }
+        else if (removed[i])
+        {
+            removePoint(i);
+        }
+    }
+    std::vector<PlanarPatch*> statePatchPoints(pointCloud()->size(), NULL);
+    statePatchPoints.swap(mPatchPoints);
+    mNumSeedPoints = pointCloud()->size() - points.size();
+
+    std::vector<PlanarPatch*> patches;
+    Octree octree(pointCloud());
+    detectPlanarPatches(&octree, mStatistics, mMinNumPoints, patches);
+    for (PlanarPatch *patch : patches)
+    {
+        for (const size_t &point : patch->points())
+        {
+            mPatchPoints[point] = patch;
+        }
+    }
+    bool changed;
+    do
+    {
+        growPatches(patches);
+        mergePatches(patches);
+        changed = updatePatches(patches);
+    } while (changed);
+    growPatches(patches, true);
+
+    statePatchPoints.swap(mPatchPoints);
+    clearRemovedPoints();
+    for (const size_t &point : removedPoints)
+    {
+        removePoint(point);
+    }
+    for (PlanarPatch *patch : patches)
+    {
+        delimitPlane(patch);
+        if (isFalsePositive(patch))
+        {
+            delete patch;
+            continue;
+        }
+        for (const size_t &point : patch->points())
+        {
+            mPatchPoints[point] = patch;
+        }
+        Plane *plane = new Plane(patch->plane());
+        plane->inliers(patch->points());
+        geometry->addPlane(plane);
+        mPatches.push_back(patch);
+        mPlanes.push_back(plane);
+    }
+}
+
+void PlaneDetector::excludeUnknownPlanes(const Geometry *geometry)
+{
+    // planes added to the geometry after the detection (e.g. by hand) keep their points
+    std::unordered_set<const Plane*> statePlanes(mPlanes.begin(), mPlanes.end());
+    for (size_t i = 0; i < geometry->numPlanes(); i++)
+    {
+        const Plane *plane = geometry->plane(i);
+        if (statePlanes.find(plane) != statePlanes.end()) continue;
+        for (const size_t &inlier : plane->inliers())
+        {
+            removePoint(inlier);
+        }
+    }
+}
+
+void PlaneDetector::refitPatches(Geometry *geometry, const std::vector<bool> &affected)
+{
+    std::vector<PlanarPatch*> patches;
+    for (size_t i = 0; i < mPatches.size(); i++)
+    {
+        if (affected[i] && mPatches[i]->points().size() >= mMinNumPoints)
+        {
+            mPatches[i]->update();
+            mPatches[i]->stable() = false;
+            patches.push_back(mPatches[i]);
+        }
+    }
+    growPatches(patches);
+    growPatches(patches, true);
+
+    std::unordered_map<const Plane*, size_t> geometryPlanes;
+    for (size_t i = 0; i < geometry->numPlanes(); i++)
+    {
+        geometryPlanes[geometry->plane(i)] = i;
+    }
+    std::vector<size_t> removedPlanes;
+    size_t numPatches = 0;
+    for (size_t i = 0; i < mPatches.size(); i++)
+    {
+        PlanarPatch *patch = mPatches[i];
+        Plane *plane = mPlanes[i];
+        if (affected[i])
+        {
+            bool valid = patch->points().size() >= mMinNumPoints;
+            if (valid)
+            {
+                delimitPlane(patch);
+                valid = !isFalsePositive(patch);
+            }
+            if (!valid)
+            {
+                for (const size_t &point : patch->points())
+                {
+                    mPatchPoints[point] = NULL;
+                }
+                removedPlanes.push_back(geometryPlanes[plane]);
+                delete patch;
+                continue;
+            }
+            plane->normal(patch->plane().normal());
+            plane->center(patch->plane().center());
+            plane->basisU(patch->plane().basisU());
+            plane->basisV(patch->plane().basisV());
+            plane->inliers(patch->points());
+        }
+        mPatches[numPatches] = patch;
+        mPlanes[numPatches] = plane;
+        ++numPatches;
+    }
+    mPatches.resize(numPatches);
+    mPlanes.resize(numPatches);
+    std::sort(removedPlanes.rbegin(), removedPlanes.rend());
+    for (const size_t &index : removedPlanes)
+    {
+        geometry->removePlane(index);
+    }
+}
+
+void PlaneDetector::sampleMemory(PlaneDetectorMetrics::Phase phase, const Octree &octree, const std::vector<PlanarPatch*> &patches,
+                                 const StatisticsUtils *statistics)
+{
+    if (!mMetrics.measureMemory()) return;
+    mMetrics.sampleMemory(phase, memoryUsage(octree, patches, statistics));
+}
+
+PlaneDetectorMetrics::Memory PlaneDetector::memoryUsage(const Octree &octree, const std::vector<PlanarPatch*> &patches,
+                                                        const StatisticsUtils *statistics) const
+{
+    PlaneDetectorMetrics::Memory memory;
+    memory.bytes[PlaneDetectorMetrics::POINTS] = pointCloud()->memoryUsage();
+    if (pointCloud()->hasConnectivity())
+    {
+        memory.bytes[PlaneDetectorMetrics::CONNECTIVITY] = pointCloud()->connectivity()->memoryUsage();
+    }
+    memory.bytes[PlaneDetectorMetrics::OCTREE] = octree.memoryUsage();
+    size_t detectorBytes = MemoryUsage::of(mPatchPoints) + MemoryUsage::of(patches) + MemoryUsage::of(mPublishedPatches) +
+            MemoryUsage::of(availablePoints()) + statistics->memoryUsage();
+    for (const PlanarPatch *patch : patches)
+    {
+        detectorBytes += patch->memoryUsage();
+    }
+    memory.bytes[PlaneDetectorMetrics::DETECTOR] = detectorBytes;
+    memory.bytes[PlaneDetectorMetrics::GEOMETRY] = mGeometryBytes;
+    return memory;
 }
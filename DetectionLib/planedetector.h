@@ -1,16 +1,26 @@
 #ifndef PLANEDETECTOR_H
 #define PLANEDETECTOR_H
 
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <unordered_set>
+
 #include "pointcloud.h"
 #include "primitivedetector.h"
 #include "planarpatch.h"
+#include "planedetectormetrics.h"
 #include "boundaryvolumehierarchy.h"
 
 class PlaneDetector : public PrimitiveDetector<3, Plane>
 {
 public:
+    typedef std::function<void(const Plane &plane)> PlaneCallback;
+
     PlaneDetector(const PointCloud3d *pointCloud);
 
+    ~PlaneDetector();
+
     Plane* detectPlane(const std::vector<size_t> &points);
 
     void growRegion(std::vector<size_t> &points);
@@ -51,11 +61,170 @@ public:
 
     std::set<Plane*> detect() override;
 
+    /**
+     * @brief Detect planes starting from the planes of a previous detection (e.g. the previous frame
+     * of a scan sequence). Points close to a seed plane are assigned to it directly, patches are only
+     * searched among the remaining points, and then everything is grown and merged as usual.
+     */
+    std::set<Plane*> detect(const Geometry *seed);
+
+    /**
+     * @brief Anytime detection: the deadline is checked between the phases and between the patches
+     * grown (the most confident and largest first). When it expires the loop stops and the patches
+     * found so far are merged (at least once) and delimited, so the deadline should leave room for that.
+     * Only the patches that were refitted or merged are returned, never the raw fragments of the first
+     * pass, so an interrupted detection finds fewer planes, not more. A budget too small to get through
+     * the first merge (e.g. under a millisecond) returns no planes.
+     * @param converged
+     *      Whether the detection finished before the deadline (same result as detect())
+     */
+    std::set<Plane*> detect(std::chrono::steady_clock::time_point deadline, bool &converged);
+
+    /**
+     * @brief Detect planes and label every point with the index of its plane in the result (-1 if it is
+     * on no plane). The planes are returned without inliers (unless the state is kept), so no per-plane
+     * index list is built. The planes of seed, if given, seed the detection like in detect(const Geometry*).
+     */
+    std::vector<Plane*> detect(std::vector<int32_t> &labels, const Geometry *seed = NULL);
+
+    /**
+     * @brief Called during the detection with every plane (delimited, with its inliers) as soon as its patch
+     * can no longer change: it is stable, has no free neighbor points and all the patches around it are
+     * final as well. The remaining planes are published when they are delimited at the end. Every plane of
+     * the result is published exactly once, and nothing else is.
+     */
+    void planeCallback(const PlaneCallback &callback)
+    {
+        mPlaneCallback = callback;
+    }
+
+    /**
+     * @brief Timings and counters of the last detection
+     */
+    const PlaneDetectorMetrics& metrics() const
+    {
+        return mMetrics;
+    }
+
+    /**
+     * @brief Print the metrics to the standard output at the end of each detection (off by default)
+     */
+    void printMetrics(bool printMetrics)
+    {
+        mPrintMetrics = printMetrics;
+    }
+
+    bool printMetrics() const
+    {
+        return mPrintMetrics;
+    }
+
+    /**
+     * @brief Add the hardware counters of each phase to the metrics (Linux perf events, off by default)
+     */
+    void countEvents(bool countEvents)
+    {
+        mMetrics.countEvents(countEvents);
+    }
+
+    bool countEvents() const
+    {
+        return mMetrics.countEvents();
+    }
+
+    /**
+     * @brief Add the bytes held by each subsystem at the end of every phase to the metrics (off by default).
+     * The geometry is measured once before the detection, since callers may add planes to it meanwhile.
+     */
+    void measureMemory(bool measureMemory)
+    {
+        mMetrics.measureMemory(measureMemory);
+    }
+
+    bool measureMemory() const
+    {
+        return mMetrics.measureMemory();
+    }
+
+    /**
+     * @brief Keep the patches of the next detections (point ownership, fitted planes and statistics)
+     * so that later edits of the point cloud can be applied incrementally
+     */
+    void keepState(bool keepState)
+    {
+        mKeepState = keepState;
+        if (!keepState) clearState();
+    }
+
+    bool keepState() const
+    {
+        return mKeepState;
+    }
+
+    bool hasState() const
+    {
+        return mStatistics != NULL;
+    }
+
+    /**
+     * @brief Whether the kept state still describes the planes of the geometry, i.e. every plane returned
+     * by the last detection is in it with the inliers the detector knows about
+     */
+    bool hasState(const Geometry *geometry) const;
+
+    void clearState();
+
+    /**
+     * @brief Detach points from the planes of the last detection (they stay in the point cloud but are not
+     * grown back). Only the planes that lose inliers are refitted, re-grown and re-delimited in the geometry.
+     */
+    void detachPoints(Geometry *geometry, const std::vector<size_t> &points);
+
+    /**
+     * @brief Apply the erasure of points from the point cloud (already done, including its connectivity)
+     * to the state and to the geometry. The indices are the ones the points had before the erasure.
+     */
+    void erasePoints(Geometry *geometry, const std::vector<size_t> &points);
+
+    /**
+     * @brief Apply the insertion of points at the end of the point cloud (already done, with normals and
+     * connectivity). The planes next to the new points are refitted and grown over them, and new planes are
+     * searched among the new points none of them took.
+     */
+    void insertPoints(Geometry *geometry, const std::vector<size_t> &points);
+
 private:
     std::vector<PlanarPatch*> mPatchPoints;
     float mMinNormalDiff;
     float mMaxDist;
     float mOutlierRatio;
+    size_t mNumSeedPoints;
+    bool mKeepState;
+    StatisticsUtils *mStatistics;
+    std::vector<PlanarPatch*> mPatches;
+    std::vector<Plane*> mPlanes;
+    size_t mMinNumPoints;
+    std::chrono::steady_clock::time_point mDeadline;
+    bool mExpired;
+    PlaneCallback mPlaneCallback;
+    std::unordered_set<const PlanarPatch*> mPublishedPatches;
+    PlaneDetectorMetrics mMetrics;
+    bool mPrintMetrics;
+    size_t mGeometryBytes;
+
+    std::vector<Plane*> detectPlanes(const Geometry *seed, std::vector<int32_t> *labels = NULL);
+
+    inline bool isExpired()
+    {
+        if (mExpired) return true;
+        if (mDeadline == std::chrono::steady_clock::time_point::max()) return false;
+        mExpired = std::chrono::steady_clock::now() > mDeadline;
+        return mExpired;
+    }
+
+    void seedPatches(const Geometry *seed, StatisticsUtils *statistics, size_t minNumPoints, std::vector<PlanarPatch*> &patches);
+
+    size_t numFreePoints(const std::vector<size_t> &points) const;
 
     bool detectPlanarPatches(Octree *node, StatisticsUtils *statistics, size_t minNumPoints, std::vector<PlanarPatch*> &patches);
 
@@ -69,6 +238,22 @@ private:
 
     bool isFalsePositive(PlanarPatch *patch);
 
+    void publishFinalPatches(std::vector<PlanarPatch*> &patches);
+
+    void publishPatch(const PlanarPatch *patch);
+
+    void excludeUnknownPlanes(const Geometry *geometry);
+
+    void refitPatches(Geometry *geometry, const std::vector<bool> &affected);
+
+    void detectLocally(Geometry *geometry, const std::vector<size_t> &points);
+
+    void sampleMemory(PlaneDetectorMetrics::Phase phase, const Octree &octree, const std::vector<PlanarPatch*> &patches,
+                      const StatisticsUtils *statistics);
+
+    PlaneDetectorMetrics::Memory memoryUsage(const Octree &octree, const std::vector<PlanarPatch*> &patches,
+                                             const StatisticsUtils *statistics) const;
+
 };
 
 #endif // PLANEDETECTOR_H
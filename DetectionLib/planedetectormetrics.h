@@ -0,0 +1,421 @@
+#ifndef PLANEDETECTORMETRICS_H
+#define PLANEDETECTORMETRICS_H
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <iomanip>
+#include <ostream>
+
+#include "trace.h"
+#include "perfcounters.h"
+
+/**
+ * @brief What the last PlaneDetector::detect() did: wall time of each phase, number of iterations of the
+ * grow/merge/update loop and number of patches after each of them, points processed and allocations.
+ * When enabled with countEvents(), the hardware counters of each phase too. When enabled with
+ * measureMemory(), the bytes held by each subsystem are sampled at the end of every phase. These are
+ * samples, not allocator measurements: the "peak" of a phase is the largest end-of-phase sample plus the
+ * transient buffers the phase reported (e.g. the merge matrices), so short-lived allocations are missed.
+ */
+class PlaneDetectorMetrics
+{
+public:
+    enum Phase
+    {
+        DETECT_PATCHES = 0,
+        GROW = 1,
+        MERGE = 2,
+        UPDATE = 3,
+        RELAXED_GROW = 4,
+        DELIMIT = 5,
+        NUM_PHASES = 6
+    };
+
+    enum Subsystem
+    {
+        POINTS = 0,
+        CONNECTIVITY = 1,
+        OCTREE = 2,
+        DETECTOR = 3,
+        GEOMETRY = 4,
+        NUM_SUBSYSTEMS = 5
+    };
+
+    struct Memory
+    {
+        size_t bytes[NUM_SUBSYSTEMS];
+
+        Memory()
+        {
+            clear();
+        }
+
+        void clear()
+        {
+            for (size_t i = 0; i < NUM_SUBSYSTEMS; i++)
+            {
+                bytes[i] = 0;
+            }
+        }
+    };
+
+    /**
+     * @brief Adds the time elapsed (and the hardware events counted) between its construction and
+     * destruction to a phase, and traces it
+     */
+    class Timer
+    {
+    public:
+        Timer(PlaneDetectorMetrics &metrics, Phase phase)
+            : mMetrics(metrics)
+            , mPhase(phase)
+            , mStart(std::chrono::steady_clock::now())
+            , mTrace(traceName(phase))
+        {
+            if (mMetrics.mCountEvents)
+            {
+                PerfCounters::forThread().read(mStartCounts);
+            }
+        }
+
+        ~Timer()
+        {
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - mStart;
+            mMetrics.mTimes[mPhase] += elapsed.count();
+            if (mMetrics.mCountEvents)
+            {
+                const PerfCounters &counters = PerfCounters::forThread();
+                PerfCounters::Values counts;
+                counters.read(counts);
+                for (size_t i = 0; i < PerfCounters::NUM_EVENTS; i++)
+                {
+                    mMetrics.mCounts[mPhase].counts[i] += counts.counts[i] - mStartCounts.counts[i];
+                    mMetrics.mEventsAvailable[i] = counters.available(PerfCounters::Event(i));
+                }
+            }
+        }
+
+    private:
+        PlaneDetectorMetrics &mMetrics;
+        Phase mPhase;
+        std::chrono::steady_clock::time_point mStart;
+        PerfCounters::Values mStartCounts;
+        TraceScope mTrace;
+
+    };
+
+    PlaneDetectorMetrics()
+        : mCountEvents(false)
+        , mMeasureMemory(false)
+    {
+        clear();
+    }
+
+    void clear()
+    {
+        for (size_t i = 0; i < NUM_PHASES; i++)
+        {
+            mTimes[i] = 0;
+            mPointsProcessed[i] = 0;
+            mCounts[i].clear();
+            mMemory[i].clear();
+            mPeakMemory[i].clear();
+            mMemorySampled[i] = false;
+        }
+        mTransientMemory.clear();
+        for (size_t i = 0; i < PerfCounters::NUM_EVENTS; i++)
+        {
+            mEventsAvailable[i] = false;
+        }
+        mNumPatchesPerIteration.clear();
+        mNumInitialPatches = 0;
+        mNumPlanes = 0;
+        mNumAllocations = 0;
+    }
+
+    static const char* phaseName(Phase phase)
+    {
+        static const char *names[NUM_PHASES] = { "detect_patches", "grow", "merge", "update", "relaxed_grow", "delimit" };
+        return names[phase];
+    }
+
+    static const char* subsystemName(Subsystem subsystem)
+    {
+        static const char *names[NUM_SUBSYSTEMS] = { "points", "connectivity", "octree", "detector", "geometry" };
+        return names[subsystem];
+    }
+
+    static const char* traceName(Phase phase)
+    {
+        static const char *names[NUM_PHASES] = { "PlaneDetector::detectPlanarPatches", "PlaneDetector::growPatches",
+                                                 "PlaneDetector::mergePatches", "PlaneDetector::updatePatches",
+                                                 "PlaneDetector::relaxedGrowPatches", "PlaneDetector::delimitPlanes" };
+        return names[phase];
+    }
+
+    /**
+     * @brief Wall time of a phase, in seconds
+     */
+    double time(Phase phase) const
+    {
+        return mTimes[phase];
+    }
+
+    double totalTime() const
+    {
+        double total = 0;
+        for (size_t i = 0; i < NUM_PHASES; i++)
+        {
+            total += mTimes[i];
+        }
+        return total;
+    }
+
+    /**
+     * @brief Points visited by a phase (queued by a growth, scanned by a merge or a delimitation, ...)
+     */
+    size_t pointsProcessed(Phase phase) const
+    {
+        return mPointsProcessed[phase];
+    }
+
+    void addPointsProcessed(Phase phase, size_t numPoints)
+    {
+        mPointsProcessed[phase] += numPoints;
+    }
+
+    /**
+     * @brief Count the cycles, instructions, LLC misses and branch misses of each phase (off by default)
+     */
+    void countEvents(bool countEvents)
+    {
+        mCountEvents = countEvents;
+    }
+
+    bool countEvents() const
+    {
+        return mCountEvents;
+    }
+
+    /**
+     * @brief Sample the bytes held by each subsystem at the end of every phase (off by default)
+     */
+    void measureMemory(bool measureMemory)
+    {
+        mMeasureMemory = measureMemory;
+    }
+
+    bool measureMemory() const
+    {
+        return mMeasureMemory;
+    }
+
+    /**
+     * @brief Whether an event could be counted in the last detection (perf events may not be allowed)
+     */
+    bool eventAvailable(PerfCounters::Event event) const
+    {
+        return mEventsAvailable[event];
+    }
+
+    uint64_t eventCount(Phase phase, PerfCounters::Event event) const
+    {
+        return mCounts[phase].counts[event];
+    }
+
+    /**
+     * @brief Records the bytes held at the end of a phase. The sampled peak of the phase also includes the
+     * transient bytes reported while it ran.
+     */
+    void sampleMemory(Phase phase, const Memory &memory)
+    {
+        for (size_t i = 0; i < NUM_SUBSYSTEMS; i++)
+        {
+            mMemory[phase].bytes[i] = memory.bytes[i];
+            mPeakMemory[phase].bytes[i] = std::max(mPeakMemory[phase].bytes[i], memory.bytes[i] + mTransientMemory.bytes[i]);
+        }
+        mMemorySampled[phase] = true;
+        mTransientMemory.clear();
+    }
+
+    /**
+     * @brief Bytes a phase holds temporarily on top of what the sample at its end sees (e.g. the merge matrices)
+     */
+    void addTransientMemory(Subsystem subsystem, size_t bytes)
+    {
+        mTransientMemory.bytes[subsystem] = std::max(mTransientMemory.bytes[subsystem], bytes);
+    }
+
+    /**
+     * @brief Bytes held at the end of the last run of a phase
+     */
+    size_t memory(Phase phase, Subsystem subsystem) const
+    {
+        return mMemory[phase].bytes[subsystem];
+    }
+
+    /**
+     * @brief Largest end-of-phase sample plus the transient bytes of the phase (a lower bound of the true peak)
+     */
+    size_t peakMemory(Phase phase, Subsystem subsystem) const
+    {
+        return mPeakMemory[phase].bytes[subsystem];
+    }
+
+    size_t peakMemory(Subsystem subsystem) const
+    {
+        size_t peak = 0;
+        for (size_t i = 0; i < NUM_PHASES; i++)
+        {
+            peak = std::max(peak, mPeakMemory[i].bytes[subsystem]);
+        }
+        return peak;
+    }
+
+    size_t numIterations() const
+    {
+        return mNumPatchesPerIteration.size();
+    }
+
+    /**
+     * @brief Number of patches left after the merge of each iteration
+     */
+    const std::vector<size_t>& numPatchesPerIteration() const
+    {
+        return mNumPatchesPerIteration;
+    }
+
+    void addIteration(size_t numPatches)
+    {
+        mNumPatchesPerIteration.push_back(numPatches);
+    }
+
+    size_t numInitialPatches() const
+    {
+        return mNumInitialPatches;
+    }
+
+    void numInitialPatches(size_t numInitialPatches)
+    {
+        mNumInitialPatches = numInitialPatches;
+    }
+
+    size_t numPlanes() const
+    {
+        return mNumPlanes;
+    }
+
+    void numPlanes(size_t numPlanes)
+    {
+        mNumPlanes = numPlanes;
+    }
+
+    /**
+     * @brief Number of patches and planes allocated by the detection
+     */
+    size_t numAllocations() const
+    {
+        return mNumAllocations;
+    }
+
+    void addAllocations(size_t numAllocations)
+    {
+        mNumAllocations += numAllocations;
+    }
+
+    std::string toJson() const
+    {
+        std::ostringstream json;
+        json << "{\"phases\":{";
+        for (size_t i = 0; i < NUM_PHASES; i++)
+        {
+            if (i > 0) json << ",";
+            json << "\"" << phaseName(Phase(i)) << "\":{\"time\":" << mTimes[i] << ",\"points\":" << mPointsProcessed[i];
+            for (size_t j = 0; j < PerfCounters::NUM_EVENTS; j++)
+            {
+                if (!mEventsAvailable[j]) continue;
+                json << ",\"" << PerfCounters::eventName(PerfCounters::Event(j)) << "\":" << mCounts[i].counts[j];
+            }
+            json << ",\"memory\":{";
+            for (size_t j = 0; j < NUM_SUBSYSTEMS; j++)
+            {
+                if (j > 0) json << ",";
+                json << "\"" << subsystemName(Subsystem(j)) << "\":{\"current\":" << mMemory[i].bytes[j] << ",\"peak\":" << mPeakMemory[i].bytes[j] << "}";
+            }
+            json << "}}";
+        }
+        json << "},\"total_time\":" << totalTime();
+        json << ",\"iterations\":" << numIterations();
+        json << ",\"initial_patches\":" << mNumInitialPatches;
+        json << ",\"patches_per_iteration\":[";
+        for (size_t i = 0; i < mNumPatchesPerIteration.size(); i++)
+        {
+            if (i > 0) json << ",";
+            json << mNumPatchesPerIteration[i];
+        }
+        json << "],\"peak_memory\":{";
+        for (size_t i = 0; i < NUM_SUBSYSTEMS; i++)
+        {
+            if (i > 0) json << ",";
+            json << "\"" << subsystemName(Subsystem(i)) << "\":" << peakMemory(Subsystem(i));
+        }
+        json << "},\"planes\":" << mNumPlanes;
+        json << ",\"allocations\":" << mNumAllocations << "}";
+        return json.str();
+    }
+
+    void print(std::ostream &out) const
+    {
+        out << "Initial patches: " << mNumInitialPatches << ", iterations: " << numIterations() << ", planes: " << mNumPlanes << std::endl;
+        for (size_t i = 0; i < NUM_PHASES; i++)
+        {
+            out << phaseName(Phase(i)) << " - Time elapsed: " << mTimes[i] << "s (" << mPointsProcessed[i] << " points)";
+            for (size_t j = 0; j < PerfCounters::NUM_EVENTS; j++)
+            {
+                if (!mEventsAvailable[j]) continue;
+                out << ", " << PerfCounters::eventName(PerfCounters::Event(j)) << ": " << mCounts[i].counts[j];
+            }
+            out << std::endl;
+            if (!mMemorySampled[i]) continue;
+            std::ios_base::fmtflags flags = out.flags();
+            std::streamsize precision = out.precision();
+            out << "    memory (end of phase / sampled peak MB) -" << std::fixed << std::setprecision(2);
+            for (size_t j = 0; j < NUM_SUBSYSTEMS; j++)
+            {
+                out << (j > 0 ? ", " : " ") << subsystemName(Subsystem(j)) << ": "
+                    << mMemory[i].bytes[j] / 1048576.0 << " / " << mPeakMemory[i].bytes[j] / 1048576.0;
+            }
+            out << std::endl;
+            out.flags(flags);
+            out.precision(precision);
+        }
+        out << "Total time elapsed: " << totalTime() << "s" << std::endl;
+        if (mCountEvents && !mEventsAvailable[PerfCounters::CYCLES] && !mEventsAvailable[PerfCounters::INSTRUCTIONS] &&
+                !mEventsAvailable[PerfCounters::LLC_MISSES] && !mEventsAvailable[PerfCounters::BRANCH_MISSES])
+        {
+            out << "Hardware counters unavailable (perf events not allowed)" << std::endl;
+        }
+    }
+
+private:
+    double mTimes[NUM_PHASES];
+    size_t mPointsProcessed[NUM_PHASES];
+    std::vector<size_t> mNumPatchesPerIteration;
+    size_t mNumInitialPatches;
+    size_t mNumPlanes;
+    size_t mNumAllocations;
+    bool mCountEvents;
+    bool mMeasureMemory;
+    PerfCounters::Values mCounts[NUM_PHASES];
+    bool mEventsAvailable[PerfCounters::NUM_EVENTS];
+    Memory mMemory[NUM_PHASES];
+    Memory mPeakMemory[NUM_PHASES];
+    bool mMemorySampled[NUM_PHASES];
+    Memory mTransientMemory;
+
+};
+
+#endif // PLANEDETECTORMETRICS_H
@@ -0,0 +1,195 @@
+#include "planemerger.h"
+
+#include "planedetector.h"
+#include "unionfind.h"
+#include "angleutils.h"
+
+PlaneMerger::PlaneMerger(const PointCloud3d *pointCloud)
+    : mPointCloud(pointCloud)
+    , mNumShards(0)
+    , mMinNormalDiff(std::cos(AngleUtils::deg2rad(10.0f)))
+    , mMaxDist(0)
+    , mMaxGap(0)
+{
+
+}
+
+PlaneMerger::~PlaneMerger()
+{
+    for (Plane *plane : mPlanes)
+    {
+        delete plane;
+    }
+}
+
+void PlaneMerger::addGeometry(const Geometry *geometry, const std::vector<size_t> &indices)
+{
+    // the shard may have been loaded with another origin than the global point cloud (e.g. '.las' shards)
+    Eigen::Vector3f offset = (geometry->origin() - mPointCloud->geometry()->origin()).cast<float>();
+    for (size_t i = 0; i < geometry->numPlanes(); i++)
+    {
+        const Plane *plane = geometry->plane(i);
+        std::vector<size_t> inliers(plane->inliers().size());
+        for (size_t j = 0; j < inliers.size(); j++)
+        {
+            size_t inlier = plane->inliers()[j];
+            if (inlier >= indices.size() || indices[inlier] >= mPointCloud->size())
+                throw "Shard inlier out of the point cloud range: " + std::to_string(inlier);
+            inliers[j] = indices[inlier];
+        }
+        Plane *globalPlane = new Plane(*plane);
+        globalPlane->center(plane->center() + offset);
+        globalPlane->inliers(inliers);
+        mPlanes.push_back(globalPlane);
+        mShards.push_back(mNumShards);
+    }
+    ++mNumShards;
+}
+
+bool PlaneMerger::isCoplanar(const Plane *a, const Plane *b, float maxDist) const
+{
+    return std::abs(a->normal().dot(b->normal())) > mMinNormalDiff &&
+            std::abs(a->getSignedDistanceFromSurface(b->center())) < maxDist &&
+            std::abs(b->getSignedDistanceFromSurface(a->center())) < maxDist;
+}
+
+Geometry* PlaneMerger::merge()
+{
+    Geometry *geometry = new Geometry;
+    geometry->origin(mPointCloud->geometry()->origin());
+    size_t n = mPlanes.size();
+    if (n == 0) return geometry;
+
+    float extent = mPointCloud->extension().maxSize();
+    float maxDist = mMaxDist > 0 ? mMaxDist : extent * 0.01f;
+    float maxGap = mMaxGap > 0 ? mMaxGap : extent * 0.01f;
+
+    // cells about the size of an average plane keep the number of cells per plane small
+    float cellSize = 0;
+    for (const Plane *plane : mPlanes)
+    {
+        cellSize += 2 * (plane->basisU().norm() + plane->basisV().norm());
+    }
+    cellSize = std::max(cellSize / n, std::max(maxGap, std::numeric_limits<float>::epsilon()));
+
+    // boxes enlarged by half the gap intersect when the rectangles are at most maxGap apart
+    PlaneIndex index(cellSize);
+    for (const Plane *plane : mPlanes)
+    {
+        index.add(plane, maxGap / 2);
+    }
+
+    // the plane each component would merge into (sums weighted by the number of inliers). Two components are
+    // only joined if all their planes are coplanar with the plane of the union and parallel to the planes of the
+    // other component, so a chain of pairwise coplanar planes (e.g. the pieces of a curved surface) cannot fuse
+    // planes that are not. The distances are only checked against the refitted plane, which is more reliable
+    // than the plane of a distant piece
+    std::vector<Eigen::Vector3f> normalSums(n);
+    std::vector<Eigen::Vector3f> centerSums(n);
+    std::vector<float> weights(n);
+    std::vector<std::vector<size_t> > members(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        weights[i] = std::max(size_t(1), mPlanes[i]->inliers().size());
+        normalSums[i] = mPlanes[i]->normal() * weights[i];
+        centerSums[i] = mPlanes[i]->center() * weights[i];
+        members[i].push_back(i);
+    }
+
+    UnionFind uf(n);
+    std::vector<size_t> candidates;
+    for (size_t i = 0; i < n; i++)
+    {
+        index.query(index.box(i), candidates);
+        for (const size_t &j : candidates)
+        {
+            if (j <= i || mShards[i] == mShards[j] || uf.connected(i, j)) continue;
+            if (!isCoplanar(mPlanes[i], mPlanes[j], maxDist)) continue;
+            size_t a = uf.root(i);
+            size_t b = uf.root(j);
+            float sign = normalSums[a].dot(normalSums[b]) < 0 ? -1.0f : 1.0f;
+            Eigen::Vector3f normalSum = normalSums[a] + normalSums[b] * sign;
+            Eigen::Vector3f centerSum = centerSums[a] + centerSums[b];
+            float weight = weights[a] + weights[b];
+            Plane merged(centerSum / weight, normalSum.normalized());
+            bool coplanar = true;
+            for (size_t k = 0; coplanar && k < members[a].size(); k++)
+            {
+                const Plane *plane = mPlanes[members[a][k]];
+                coplanar = isCoplanar(plane, &merged, maxDist);
+                for (size_t l = 0; coplanar && l < members[b].size(); l++)
+                {
+                    coplanar = std::abs(plane->normal().dot(mPlanes[members[b][l]]->normal())) > mMinNormalDiff;
+                }
+            }
+            for (size_t l = 0; coplanar && l < members[b].size(); l++)
+            {
+                coplanar = isCoplanar(mPlanes[members[b][l]], &merged, maxDist);
+            }
+            if (!coplanar) continue;
+            uf.join(a, b);
+            size_t root = uf.root(a);
+            size_t other = root == a ? b : a;
+            normalSums[root] = normalSum;
+            centerSums[root] = centerSum;
+            weights[root] = weight;
+            members[root].insert(members[root].end(), members[other].begin(), members[other].end());
+            std::vector<size_t>().swap(members[other]);
+        }
+    }
+
+    PlaneDetector detector(mPointCloud);
+    for (const std::vector<size_t> &component : members)
+    {
+        if (component.empty()) continue;
+        if (component.size() == 1)
+        {
+            geometry->addPlane(mPlanes[component[0]]);
+            mPlanes[component[0]] = NULL;
+            continue;
+        }
+        size_t largest = component[0];
+        for (const size_t &i : component)
+        {
+            if (mPlanes[i]->inliers().size() > mPlanes[largest]->inliers().size())
+            {
+                largest = i;
+            }
+        }
+        // weighted by the number of inliers, with normals flipped towards the largest plane
+        Eigen::Vector3f normal = Eigen::Vector3f::Zero();
+        Eigen::Vector3f center = Eigen::Vector3f::Zero();
+        float totalWeight = 0;
+        std::vector<size_t> inliers;
+        for (const size_t &i : component)
+        {
+            const Plane *plane = mPlanes[i];
+            float weight = std::max(size_t(1), plane->inliers().size());
+            float sign = plane->normal().dot(mPlanes[largest]->normal()) < 0 ? -1.0f : 1.0f;
+            normal += plane->normal() * sign * weight;
+            center += plane->center() * weight;
+            totalWeight += weight;
+            inliers.insert(inliers.end(), plane->inliers().begin(), plane->inliers().end());
+        }
+        std::sort(inliers.begin(), inliers.end());
+        inliers.erase(std::unique(inliers.begin(), inliers.end()), inliers.end());
+        Plane *plane = new Plane(center / totalWeight, normal.normalized());
+        plane->color(mPlanes[largest]->color());
+        plane->inliers(inliers);
+        if (!inliers.empty())
+        {
+            detector.delimitPlane(plane);
+        }
+        geometry->addPlane(plane);
+        for (const size_t &i : component)
+        {
+            delete mPlanes[i];
+            mPlanes[i] = NULL;
+        }
+    }
+    mPlanes.clear();
+    mShards.clear();
+    mNumShards = 0;
+
+    return geometry;
+}
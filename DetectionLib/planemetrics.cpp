@@ -0,0 +1 @@
+#include "planemetrics.h"
@@ -3,15 +3,32 @@
 
 #include <iostream>
 
+#include "trace.h"
+
 int main(int argc, char *argv[])
 {
     try
     {
         QApplication a(argc, argv);
+        // --trace <file.json> records a Chrome trace of the workers, saved on exit
+        std::string traceFileName;
+        for (int i = 1; i + 1 < argc; i++)
+        {
+            if (std::string(argv[i]) == "--trace")
+            {
+                traceFileName = argv[i + 1];
+            }
+        }
+        Trace::enable(!traceFileName.empty());
         MainWindow w;
         w.show();
 
-        return a.exec();
+        int result = a.exec();
+        if (!traceFileName.empty() && !Trace::save(traceFileName))
+        {
+            std::cerr << "Could not save the trace: " << traceFileName << std::endl;
+        }
+        return result;
     }
     catch (const char *s)
     {
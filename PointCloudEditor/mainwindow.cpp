@@ -273,6 +273,7 @@ void MainWindow::initSceneObjects()
     connect(mPlaneDetectorWorker, SIGNAL(workerProgress(float)), this, SLOT(workerProgress(float)));
     connect(mPlaneDetectorWorker, SIGNAL(workerStatus(const QString&)), this, SLOT(workerStatus(const QString&)));
     connect(mPlaneDetectorWorker, SIGNAL(workerFinish()), this, SLOT(planeDetectionFinish()));
+    connect(mPlaneDetectorWorker, SIGNAL(planeDetected()), this, SLOT(planeDetected()));
     connect(&mPlaneDetectorDialog, SIGNAL(detectPlaneOptions(float, float, float)), this, SLOT(detectPlanes(float, float, float)));
 }
 
@@ -805,6 +806,7 @@ void MainWindow::transformTranslate()
 void MainWindow::translatePointCloud(float dx, float dy, float dz)
 {
     addState();
+    mPlaneDetectorWorker->detector()->clearState();
     mTranslateWorker->translation(dx, dy, dz);
     workerStart(mTranslateWorker);
 }
@@ -826,6 +828,7 @@ void MainWindow::translateFinish()
 void MainWindow::scalePointCloud(float dx, float dy, float dz)
 {
     addState();
+    mPlaneDetectorWorker->detector()->clearState();
     mScaleWorker->scale(dx, dy, dz);
     workerStart(mScaleWorker);
 }
@@ -852,6 +855,7 @@ void MainWindow::transformScale()
 void MainWindow::rotatePointCloud(float x, float y, float z, float degrees)
 {
     addState();
+    mPlaneDetectorWorker->detector()->clearState();
     mRotateWorker->rotate(x, y, z, degrees);
     workerStart(mRotateWorker);
 }
@@ -929,13 +933,30 @@ void MainWindow::editRemove()
     addState();
     if (mSelectFilter->mode() == SelectFilter::SelectMode::POINT)
     {
+        // the state is checked against the point cloud before the erasure
+        PlaneDetector *planeDetector = mPlaneDetectorWorker->detector();
+        bool incremental = mPointCloud->hasConnectivity() && planeDetector->hasState(mPointCloud->geometry());
+        std::vector<size_t> removed;
         for (int i = mPointCloud->size() - 1; i >= 0; i--)
         {
             if (mSelectFilter->isSelected(i))
             {
                 mPointCloud->remove(i);
+                removed.push_back(i);
             }
         }
+        if (mPointCloud->hasConnectivity())
+        {
+            mPointCloud->connectivity()->removeNodes(removed);
+        }
+        if (incremental)
+        {
+            planeDetector->erasePoints(mPointCloud->geometry(), removed);
+        }
+        else
+        {
+            planeDetector->clearState();
+        }
         mSimplifiedPointCloud->update();
     }
     else if (mSelectFilter->mode() == SelectFilter::SelectMode::PLANE)
@@ -981,14 +1002,26 @@ void MainWindow::editRemoveFromPrimitives()
     if (mSelectFilter->mode() == SelectFilter::SelectMode::POINT)
     {
         std::vector<bool> removed(mPointCloud->size(), false);
+        std::vector<size_t> removedPoints;
         for (size_t i = 0; i < mPointCloud->size(); i++)
         {
             if (mSelectFilter->isSelected(i))
             {
                 removed[i] = true;
+                removedPoints.push_back(i);
             }
         }
-        PlaneDetector *planeDetector = new PlaneDetector(mPointCloud);
+        PlaneDetector *planeDetector = mPlaneDetectorWorker->detector();
+        if (mPointCloud->hasConnectivity() && planeDetector->hasState(mPointCloud->geometry()))
+        {
+            // the planes of the last detection that lose points are refitted and re-grown around the
+            // detached points, the other planes are only delimited again below
+            planeDetector->detachPoints(mPointCloud->geometry(), removedPoints);
+        }
+        else
+        {
+            planeDetector->clearState();
+        }
         for (size_t i = 0; i < mPointCloud->geometry()->numPlanes(); i++)
         {
             Plane *plane = mPointCloud->geometry()->plane(i);
@@ -1002,7 +1035,6 @@ void MainWindow::editRemoveFromPrimitives()
                 planeDetector->delimitPlane(plane);
             }
         }
-        delete planeDetector;
         for (size_t i = 0; i < mPointCloud->geometry()->numCylinders(); i++)
         {
             Cylinder *cylinder = mPointCloud->geometry()->cylinder(i);
@@ -1021,6 +1053,7 @@ void MainWindow::editRemoveFromPrimitives()
                 cylinder->leastSquares(points);
             }
         }
+        mSelectFilter->update(mPointCloud->size(), mPointCloud->geometry()->numPlanes(), mPointCloud->geometry()->numCylinders(), mPointCloud->geometry()->numConnections());
         updatePrimitives();
         selectNone();
     }
@@ -1376,6 +1409,7 @@ void MainWindow::setConnectivity()
 {
     if (mPointCloudIOWorker->connectivity() == NULL) return;
     mPointCloud->connectivity(mPointCloudIOWorker->connectivity());
+    mPlaneDetectorWorker->detector()->clearState();
     updatePointCloud();
 }
 
@@ -1534,6 +1568,7 @@ void MainWindow::estimateNormalsQuick()
 
 void MainWindow::normalEstimationFinish()
 {
+    mPlaneDetectorWorker->detector()->clearState();
     mPointCloud->mode(mPointCloud->mode() | PointCloud3d::Mode::NORMAL | PointCloud3d::Mode::NORMAL_CONFIDENCE | PointCloud3d::Mode::CURVATURE);
     mSimplifiedPointCloud->update();
     mNormalDrawer->update();
@@ -1637,6 +1672,23 @@ void MainWindow::expandPlaneRegion()
     }
 }
 
+void MainWindow::planeDetected()
+{
+    // planes are shown as soon as the detector knows they are final (already delimited), the finish replaces
+    // them with the result
+    std::vector<Plane*> planes = mPlaneDetectorWorker->takeDetectedPlanes();
+    if (planes.empty()) return;
+    for (Plane *plane : planes)
+    {
+        plane->color(ColorUtils::colorWheel(rand() % 360));
+        mPointCloud->geometry()->addPlane(plane);
+        mDetectedPlaneColors[plane->inliers().front()] = plane->color();
+    }
+    mPlaneDrawer->update();
+    mPointCloudDrawer->update();
+    mSceneWidget->update();
+}
+
 void MainWindow::planeDetectionFinish()
 {
     QApplication::setOverrideCursor(Qt::WaitCursor);
@@ -1647,13 +1699,20 @@ void MainWindow::planeDetectionFinish()
     case PlaneDetectorWorker::Mode::AUTODETECT:
         std::cout << "Done in " + std::to_string(mPlaneDetectorWorker->timeElapsedInSec()) + "s." << std::endl;
         statusBar()->showMessage(("Done in " + std::to_string(mPlaneDetectorWorker->timeElapsedInSec()) + "s. Number of planes: " + std::to_string(mPlaneDetectorWorker->planes().size()) + ".").c_str());
+        for (Plane *plane : mPlaneDetectorWorker->takeDetectedPlanes())
+        {
+            delete plane;
+        }
         mPointCloud->geometry()->clearPlanes();
         for (Plane *plane : mPlaneDetectorWorker->planes())
         {
-            plane->color(ColorUtils::colorWheel(rand() % 360));
+            // keep the colors the planes were shown with while the detection was running
+            auto color = mDetectedPlaneColors.find(plane->inliers().empty() ? 0 : plane->inliers().front());
+            plane->color(color != mDetectedPlaneColors.end() ? color->second : ColorUtils::colorWheel(rand() % 360));
             mPlaneDetectorWorker->detector()->delimitPlane(plane);
             mPointCloud->geometry()->addPlane(plane);
         }
+        mDetectedPlaneColors.clear();
         mPlaneDrawer->update();
         mPointCloudDrawer->update();
         mSceneWidget->update();
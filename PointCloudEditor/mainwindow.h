@@ -1,6 +1,8 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
+#include <unordered_map>
+
 #include <QStatusBar>
 #include <QProgressBar>
 
@@ -93,6 +95,7 @@ private slots:
     void detectPlane();
     void expandPlaneRegion();
     void mergePlanes();
+    void planeDetected();
     void planeDetectionFinish();
 
     void pointCloudInfo();
@@ -185,6 +188,7 @@ private:
     Plane *mProjectionPlane;
 
     std::vector<PointCloud3d*> mEditStates;
+    std::unordered_map<size_t, Eigen::Vector3f> mDetectedPlaneColors;
 
     void enablePointCloudChange(bool enabled);
     void initMenu();
@@ -5,6 +5,8 @@
 //#include <tbb/mutex.h>
 
 #include "boundaryvolumehierarchy.h"
+#include "gridnormalestimator.h"
+#include "trace.h"
 
 NormalEstimatorWorker::NormalEstimatorWorker(PointCloud3d *pointCloud)
     : mPointCloud(pointCloud)
@@ -18,6 +20,38 @@ void NormalEstimatorWorker::actions()
 {
     if (mPointCloud == NULL) return;
 
+    if (mPointCloud->isOrganized())
+    {
+        emit workerStatus("Estimating normals...");
+
+        ConnectivityGraph *connectivity = new ConnectivityGraph(mPointCloud->size());
+        mPointCloud->connectivity(connectivity);
+
+        GridNormalEstimator estimator(mPointCloud, mNumNeighbors);
+        TraceScope trace("GridNormalEstimator::estimate", "points", mPointCloud->size());
+        size_t count = 0;
+        for (const ScanGrid &scan : mPointCloud->scans())
+        {
+            for (size_t column = 0; column < scan.width() && isRunning(); column++)
+            {
+                for (size_t row = 0; row < scan.height(); row++)
+                {
+                    if (scan.at(row, column) == ScanGrid::NONE) continue;
+                    NormalEstimator3d::Normal normal = estimator.estimate(scan, row, column);
+                    connectivity->addNode(normal.point, normal.neighbors);
+                    (*mPointCloud)[normal.point].normal(normal.normal);
+                    (*mPointCloud)[normal.point].normalConfidence(normal.confidence);
+                    (*mPointCloud)[normal.point].curvature(normal.curvature);
+                    if (++count % 1000 == 0)
+                    {
+                        emit workerProgress(static_cast<float>(count) / mPointCloud->size());
+                    }
+                }
+            }
+        }
+        return;
+    }
+
     emit workerStatus("Pre-processing...");
 
     Octree octree(mPointCloud);
@@ -29,6 +63,7 @@ void NormalEstimatorWorker::actions()
     mPointCloud->connectivity(connectivity);
 
     NormalEstimator3d estimator(&octree, mNumNeighbors, mSpeed);
+    TraceScope trace("NormalEstimator::estimate", "points", mPointCloud->size());
 
     //tbb::mutex mutex;
     size_t count = 0;
@@ -4,7 +4,7 @@ PlaneDetectorWorker::PlaneDetectorWorker(const PointCloud3d *pointCloud)
     : mDetector(new PlaneDetector(pointCloud))
     , mMode(AUTODETECT)
 {
-
+    mDetector->keepState(true);
 }
 
 PlaneDetectorWorker::~PlaneDetectorWorker()
@@ -14,9 +14,21 @@ PlaneDetectorWorker::~PlaneDetectorWorker()
 
 void PlaneDetectorWorker::pointCloud(const PointCloud3d *pointCloud)
 {
+    // edits of the same point cloud are applied to the state of the last detection
+    if (pointCloud == mDetector->pointCloud() && mDetector->hasState()) return;
+    mDetector->clearState();
     mDetector->pointCloud(pointCloud);
 }
 
+std::vector<Plane*> PlaneDetectorWorker::takeDetectedPlanes()
+{
+    mDetectedPlanesMutex.lock();
+    std::vector<Plane*> planes;
+    planes.swap(mDetectedPlanes);
+    mDetectedPlanesMutex.unlock();
+    return planes;
+}
+
 void PlaneDetectorWorker::actions()
 {
     switch (mMode)
@@ -24,7 +36,14 @@ void PlaneDetectorWorker::actions()
     case Mode::AUTODETECT:
     {
         emit workerStatus(QString("Detecting planes..."));
+        mDetector->planeCallback([this](const Plane &plane) {
+            mDetectedPlanesMutex.lock();
+            mDetectedPlanes.push_back(new Plane(plane));
+            mDetectedPlanesMutex.unlock();
+            emit planeDetected();
+        });
         std::set<Plane*> planes = mDetector->detect();
+        mDetector->planeCallback(PlaneDetector::PlaneCallback());
         mPlanes = std::vector<Plane*>(planes.begin(), planes.end());
         break;
     }
@@ -1,11 +1,14 @@
 #ifndef PLANEDETECTORWORKER_H
 #define PLANEDETECTORWORKER_H
 
+#include <QMutex>
+
 #include "worker.h"
 #include "planedetector.h"
 
 class PlaneDetectorWorker : public Worker
 {
+    Q_OBJECT
 public:
     enum Mode
     {
@@ -57,11 +60,21 @@ public:
         return mDetector;
     }
 
+    /**
+     * @brief Planes published by the detector since the last call (AUTODETECT), owned by the caller
+     */
+    std::vector<Plane*> takeDetectedPlanes();
+
+signals:
+    void planeDetected();
+
 private:
     PlaneDetector *mDetector;
     Mode mMode;
     std::vector<Plane*> mPlanes;
     std::vector<size_t> mRegion;
+    std::vector<Plane*> mDetectedPlanes;
+    QMutex mDetectedPlanesMutex;
 
     void actions() override;
 
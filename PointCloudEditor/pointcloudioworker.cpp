@@ -36,7 +36,15 @@ void PointCloudIOWorker::actions()
         break;
     case LOAD_GEOMETRY:
         emit workerStatus("Loading geometry...");
-        mGeometry = mLoader.loadGeometry(mFilename);
+        try
+        {
+            mGeometry = mLoader.loadGeometry(mFilename);
+        }
+        catch (const std::string &error)
+        {
+            mGeometry = NULL;
+            emit loadError(QString(error.c_str()));
+        }
         break;
     case SAVE_POINT_CLOUD:
         emit workerStatus("Saving point cloud...");
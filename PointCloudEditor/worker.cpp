@@ -2,6 +2,8 @@
 
 #include <QElapsedTimer>
 
+#include "trace.h"
+
 Worker::Worker()
     : mStopped(true)
 {
@@ -35,7 +37,11 @@ void Worker::onRun()
     QElapsedTimer timer;
     timer.start();
     emit workerStart();
-    actions();
+    {
+        Trace::threadName(metaObject()->className());
+        TraceScope trace(metaObject()->className());
+        actions();
+    }
     mTimeElapsed = timer.nsecsElapsed();
     mThread.terminate();
     emit workerFinish();